@@ -51,6 +51,9 @@
 #define PORT0               1
 #define MOTOR               (0x100+0)
 
+//analog in port 0
+#define LOAD                (0x000+0)
+
 //non-existing ports (for alignment)
 #define BUTTON_DOWN1        -1
 #define BUTTON_UP4          -1
@@ -1,8 +1,22 @@
 #include "hardware.h"
 #include "channels.h"
 #include "io.h"
+#include "wear.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+// Sampling period for hardware-timed input acquisition. 0 polls the
+// inputs on every read instead.
+#ifndef HARDWARE_SAMPLE_PERIOD_NS
+#define HARDWARE_SAMPLE_PERIOD_NS 0
+#endif
+
+// Raw reading of the load cell at rated load; 0 means no load cell is
+// fitted, e.g. DEFINES=-DHARDWARE_LOAD_FULL_SCALE=4095 enables it.
+#ifndef HARDWARE_LOAD_FULL_SCALE
+#define HARDWARE_LOAD_FULL_SCALE 0
+#endif
 
 static int hardware_legal_floor(int floor, HardwareOrder order_type){
     int lower_floor = 0;
@@ -47,6 +61,7 @@ int hardware_init(){
     if(!io_init()){
         return 1;
     }
+    io_emergency_init(MOTOR);
 
     for(int i = 0; i < HARDWARE_NUMBER_OF_FLOORS; i++){
         if(i != 0){
@@ -64,10 +79,31 @@ int hardware_init(){
     hardware_command_door_open(0);
     hardware_command_floor_indicator_on(0);
 
+    if(HARDWARE_SAMPLE_PERIOD_NS > 0){
+        io_stream_start(HARDWARE_SAMPLE_PERIOD_NS);
+    }
+
     return 0;
 }
 
+void hardware_tick(){
+    io_stream_update();
+}
+
+void hardware_read_latency(HardwareLatency *latency){
+    memset(latency, 0, sizeof(*latency));
+}
+
+void hardware_emergency_stop(){
+    io_emergency_write();
+}
+
+void hardware_read_wear(HardwareWear *wear){
+    wear_read(wear);
+}
+
 void hardware_command_movement(HardwareMovement movement){
+    wear_record_movement(movement);
     switch(movement){
         case HARDWARE_MOVEMENT_UP:
             io_clear_bit(MOTORDIR);
@@ -116,7 +152,17 @@ int hardware_read_floor_sensor(int floor){
             return 0;
     }
 
-    return io_read_bit(floor_bit);
+    int value = io_read_bit(floor_bit);
+    wear_record_floor_sensor(floor, value);
+    return value;
+}
+
+int hardware_read_load(){
+#if HARDWARE_LOAD_FULL_SCALE > 0
+    return io_read_analog(LOAD) * 100 / HARDWARE_LOAD_FULL_SCALE;
+#else
+    return 0;
+#endif
 }
 
 int hardware_read_order(int floor, HardwareOrder order_type){
@@ -0,0 +1,348 @@
+// Backend for hardware.h that talks to the TCP elevator simulator server.
+//
+// All commands issued during a tick are kept as pending output state and
+// sent together with the input queries in one write on the next call to
+// hardware_tick(). The replies are read back in one go and cached, so a
+// tick costs a single round trip no matter how often the inputs are read.
+#define _POSIX_C_SOURCE 200809L
+
+#include "hardware.h"
+#include "wear.h"
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#ifndef HARDWARE_TCP_ADDRESS
+#define HARDWARE_TCP_ADDRESS "127.0.0.1"
+#endif
+
+#ifndef HARDWARE_TCP_PORT
+#define HARDWARE_TCP_PORT 15657
+#endif
+
+#define ORDER_TYPES 3
+
+// Message ids in the simulator protocol. Every message is four bytes.
+enum {
+    MSG_MOTOR_DIRECTION = 1,
+    MSG_ORDER_LIGHT = 2,
+    MSG_FLOOR_INDICATOR = 3,
+    MSG_DOOR_OPEN = 4,
+    MSG_STOP_LIGHT = 5,
+    MSG_ORDER_BUTTON = 6,
+    MSG_FLOOR_SENSOR = 7,
+    MSG_STOP_BUTTON = 8,
+    MSG_OBSTRUCTION = 9
+};
+
+// Outputs, as last commanded, and whether they still have to be sent.
+typedef struct {
+    int value;
+    int dirty;
+} Output;
+
+static int sock_fd = -1;
+
+// Second connection, only used by hardware_emergency_stop().
+static int stop_fd = -1;
+static const unsigned char stop_msg[4] = {MSG_MOTOR_DIRECTION, 0, 0, 0};
+
+static Output motor;
+static Output order_light[HARDWARE_NUMBER_OF_FLOORS][ORDER_TYPES];
+static Output floor_indicator;
+static Output door_open;
+static Output stop_light;
+
+// Inputs from the last round trip.
+static int order_button[HARDWARE_NUMBER_OF_FLOORS][ORDER_TYPES];
+static int floor_sensor = -1;
+static int stop_button;
+static int obstruction;
+
+static unsigned long round_trips;
+static long round_trip_us;
+static long round_trip_total_us;
+static long round_trip_worst_us;
+
+static int hardware_legal_floor(int floor, HardwareOrder order_type){
+    if(floor < 0 || floor > HARDWARE_NUMBER_OF_FLOORS - 1){
+        return 0;
+    }
+    if(floor == 0 && order_type == HARDWARE_ORDER_DOWN){
+        return 0;
+    }
+    if(floor == HARDWARE_NUMBER_OF_FLOORS - 1 && order_type == HARDWARE_ORDER_UP){
+        return 0;
+    }
+    return 1;
+}
+
+// The simulator numbers buttons up, down, cab.
+static int hardware_order_type_bit(HardwareOrder order_type){
+    switch(order_type){
+        case HARDWARE_ORDER_UP:
+            return 0;
+        case HARDWARE_ORDER_DOWN:
+            return 1;
+        default:
+            return 2;
+    }
+}
+
+static void hardware_set_output(Output *output, int value){
+    if(output->value != value){
+        output->value = value;
+        output->dirty = 1;
+    }
+}
+
+static unsigned char *hardware_put_msg(unsigned char *p, int id, int a, int b, int c){
+    p[0] = id;
+    p[1] = a;
+    p[2] = b;
+    p[3] = c;
+    return p + 4;
+}
+
+static void hardware_lost_connection(){
+    fprintf(stderr, "Lost connection to elevator simulator\n");
+    exit(1);
+}
+
+static void hardware_send_all(const unsigned char *buf, size_t len){
+    while(len > 0){
+        ssize_t n = send(sock_fd, buf, len, MSG_NOSIGNAL);
+        if(n <= 0){
+            hardware_lost_connection();
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+static void hardware_recv_all(unsigned char *buf, size_t len){
+    while(len > 0){
+        ssize_t n = recv(sock_fd, buf, len, 0);
+        if(n <= 0){
+            hardware_lost_connection();
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+static long hardware_elapsed_us(const struct timespec *start){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+// Opens a connection to the simulator, -1 on failure.
+static int hardware_connect(){
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(HARDWARE_TCP_PORT);
+    if(inet_pton(AF_INET, HARDWARE_TCP_ADDRESS, &addr.sin_addr) != 1){
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0){
+        return -1;
+    }
+    if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0){
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+int hardware_init(){
+    sock_fd = hardware_connect();
+    if(sock_fd < 0){
+        return 1;
+    }
+    // The emergency stop must never block, so its connection is non-blocking.
+    stop_fd = hardware_connect();
+    if(stop_fd >= 0 && fcntl(stop_fd, F_SETFL, O_NONBLOCK) != 0){
+        close(stop_fd);
+        stop_fd = -1;
+    }
+
+    // Start from a known state by marking every output as changed.
+    motor = (Output){HARDWARE_MOVEMENT_STOP, 1};
+    for(int f = 0; f < HARDWARE_NUMBER_OF_FLOORS; f++){
+        for(int t = 0; t < ORDER_TYPES; t++){
+            order_light[f][t] = (Output){0, 1};
+        }
+    }
+    floor_indicator = (Output){0, 1};
+    door_open = (Output){0, 1};
+    stop_light = (Output){0, 1};
+
+    hardware_tick();
+    return 0;
+}
+
+void hardware_tick(){
+    // Worst case: every output changed, plus one query per input.
+    unsigned char request[4 * (2 * HARDWARE_NUMBER_OF_FLOORS * ORDER_TYPES + 8)];
+    unsigned char reply[4 * (HARDWARE_NUMBER_OF_FLOORS * ORDER_TYPES + 3)];
+    unsigned char *p = request;
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if(motor.dirty){
+        int direction = motor.value == HARDWARE_MOVEMENT_UP ? 1
+            : motor.value == HARDWARE_MOVEMENT_DOWN ? 0xff : 0;
+        p = hardware_put_msg(p, MSG_MOTOR_DIRECTION, direction, 0, 0);
+        motor.dirty = 0;
+    }
+    for(int f = 0; f < HARDWARE_NUMBER_OF_FLOORS; f++){
+        for(int t = 0; t < ORDER_TYPES; t++){
+            if(order_light[f][t].dirty){
+                p = hardware_put_msg(p, MSG_ORDER_LIGHT, t, f, order_light[f][t].value);
+                order_light[f][t].dirty = 0;
+            }
+        }
+    }
+    if(floor_indicator.dirty){
+        p = hardware_put_msg(p, MSG_FLOOR_INDICATOR, floor_indicator.value, 0, 0);
+        floor_indicator.dirty = 0;
+    }
+    if(door_open.dirty){
+        p = hardware_put_msg(p, MSG_DOOR_OPEN, door_open.value, 0, 0);
+        door_open.dirty = 0;
+    }
+    if(stop_light.dirty){
+        p = hardware_put_msg(p, MSG_STOP_LIGHT, stop_light.value, 0, 0);
+        stop_light.dirty = 0;
+    }
+
+    int queries = 0;
+    for(int f = 0; f < HARDWARE_NUMBER_OF_FLOORS; f++){
+        for(HardwareOrder o = HARDWARE_ORDER_UP; o <= HARDWARE_ORDER_DOWN; o++){
+            if(hardware_legal_floor(f, o)){
+                p = hardware_put_msg(p, MSG_ORDER_BUTTON, hardware_order_type_bit(o), f, 0);
+                queries++;
+            }
+        }
+    }
+    p = hardware_put_msg(p, MSG_FLOOR_SENSOR, 0, 0, 0);
+    p = hardware_put_msg(p, MSG_STOP_BUTTON, 0, 0, 0);
+    p = hardware_put_msg(p, MSG_OBSTRUCTION, 0, 0, 0);
+    queries += 3;
+
+    hardware_send_all(request, p - request);
+    hardware_recv_all(reply, 4 * queries);
+
+    // Replies arrive in the order the queries were sent.
+    unsigned char *r = reply;
+    for(int f = 0; f < HARDWARE_NUMBER_OF_FLOORS; f++){
+        for(HardwareOrder o = HARDWARE_ORDER_UP; o <= HARDWARE_ORDER_DOWN; o++){
+            if(hardware_legal_floor(f, o)){
+                order_button[f][hardware_order_type_bit(o)] = r[1];
+                r += 4;
+            }
+        }
+    }
+    floor_sensor = r[1] ? r[2] : -1;
+    wear_record_floor_sensor(floor_sensor, floor_sensor >= 0);
+    stop_button = r[5];
+    obstruction = r[9];
+
+    round_trip_us = hardware_elapsed_us(&start);
+    round_trips++;
+    round_trip_total_us += round_trip_us;
+    if(round_trip_us > round_trip_worst_us){
+        round_trip_worst_us = round_trip_us;
+    }
+}
+
+void hardware_read_latency(HardwareLatency *latency){
+    latency->round_trips = round_trips;
+    latency->last_us = round_trip_us;
+    latency->mean_us = round_trips ? round_trip_total_us / (long)round_trips : 0;
+    latency->worst_us = round_trip_worst_us;
+}
+
+void hardware_read_wear(HardwareWear *wear){
+    wear_read(wear);
+}
+
+void hardware_command_movement(HardwareMovement movement){
+    wear_record_movement(movement);
+    hardware_set_output(&motor, movement);
+
+    // Stopping is not deferred to the next tick.
+    if(movement == HARDWARE_MOVEMENT_STOP && motor.dirty){
+        unsigned char msg[4];
+        hardware_put_msg(msg, MSG_MOTOR_DIRECTION, 0, 0, 0);
+        hardware_send_all(msg, sizeof(msg));
+        motor.dirty = 0;
+    }
+}
+
+void hardware_emergency_stop(){
+    if(stop_fd >= 0){
+        send(stop_fd, stop_msg, sizeof(stop_msg), MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+}
+
+int hardware_read_stop_signal(){
+    return stop_button;
+}
+
+int hardware_read_obstruction_signal(){
+    return obstruction;
+}
+
+int hardware_read_floor_sensor(int floor){
+    return floor_sensor >= 0 && floor_sensor == floor;
+}
+
+// The simulator has no load cell.
+int hardware_read_load(){
+    return 0;
+}
+
+int hardware_read_order(int floor, HardwareOrder order_type){
+    if(!hardware_legal_floor(floor, order_type)){
+        return 0;
+    }
+    return order_button[floor][hardware_order_type_bit(order_type)];
+}
+
+void hardware_command_door_open(int door_open_value){
+    hardware_set_output(&door_open, door_open_value != 0);
+}
+
+void hardware_command_floor_indicator_on(int floor){
+    if(floor < 0 || floor > HARDWARE_NUMBER_OF_FLOORS - 1){
+        return;
+    }
+    hardware_set_output(&floor_indicator, floor);
+}
+
+void hardware_command_stop_light(int on){
+    hardware_set_output(&stop_light, on != 0);
+}
+
+void hardware_command_order_light(int floor, HardwareOrder order_type, int on){
+    if(!hardware_legal_floor(floor, order_type)){
+        return;
+    }
+    hardware_set_output(&order_light[floor][hardware_order_type_bit(order_type)], on != 0);
+}
@@ -4,17 +4,66 @@
 //
 // 2006, Martin Korsgaard
 
+#define _POSIX_C_SOURCE 200809L
 
 #include "io.h"
 #include "channels.h"
 
 #include <comedilib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
 
 
 static comedi_t *it_g = NULL;
 
 
 
+// Hardware-timed acquisition of the inputs of one subdevice. Each subdevice
+// gets its own comedi handle, since the buffer mapped through a file
+// descriptor is the one of its read subdevice. A sample holds all channels
+// of the subdevice as a bit field. Only the input channels are answered
+// from the stream; the outputs sharing the subdevice are always polled.
+// Buttons and STOP are latched: they read high if they were high in any
+// sample since the last update. Floor sensors and obstruction read as in
+// the newest sample, so a floor the car has already passed is not seen.
+typedef struct {
+    int subdevice;
+    unsigned int first_input;
+    unsigned int latched;
+    comedi_t *it;
+    const unsigned char *buffer;
+    unsigned int buffer_size;
+    unsigned int sample_size;
+    unsigned int level;
+    unsigned int seen;
+    int active;
+} IoStream;
+
+#define IO_STREAM_INPUTS 8
+
+#define IO_BIT(channel) (1u << ((channel) & 0xff))
+
+static IoStream streams[] = {
+    {PORT1, 0, IO_BIT(BUTTON_DOWN2) | IO_BIT(BUTTON_UP3) | IO_BIT(BUTTON_DOWN3) | IO_BIT(BUTTON_DOWN4)},
+    {PORT4, 16, IO_BIT(BUTTON_UP2) | IO_BIT(BUTTON_UP1) | IO_BIT(BUTTON_COMMAND4) | IO_BIT(BUTTON_COMMAND3)
+        | IO_BIT(BUTTON_COMMAND2) | IO_BIT(BUTTON_COMMAND1) | IO_BIT(STOP)}
+};
+
+#define IO_STREAMS (sizeof(streams) / sizeof(streams[0]))
+
+
+
+// Write of 0 to one analog channel, encoded in advance on a handle of its
+// own, so that it can be issued from a signal handler as a single ioctl.
+static comedi_t *emergency_it = NULL;
+static int emergency_fd = -1;
+static lsampl_t emergency_value = 0;
+static comedi_insn emergency_insn;
+
+
+
 int io_init() {
     int i = 0;
     int status = 0;
@@ -55,6 +104,14 @@ void io_write_analog(int channel, int value) {
 
 
 int io_read_bit(int channel) {
+    for (unsigned int i = 0; i < IO_STREAMS; i++) {
+        const IoStream *stream = &streams[i];
+        unsigned int bit = channel & 0xff;
+        if (stream->active && stream->subdevice == channel >> 8
+            && bit >= stream->first_input && bit < stream->first_input + IO_STREAM_INPUTS)
+            return (((stream->seen & stream->latched) | (stream->level & ~stream->latched)) >> bit) & 1;
+    }
+
     unsigned int data = 0;
     comedi_dio_read(it_g, channel >> 8, channel & 0xff, &data);
 
@@ -69,3 +126,152 @@ int io_read_analog(int channel) {
 
     return (int)data;
 }
+
+
+
+int io_emergency_init(int channel) {
+    emergency_it = comedi_open("/dev/comedi0");
+    if (emergency_it == NULL)
+        return 0;
+
+    memset(&emergency_insn, 0, sizeof(emergency_insn));
+    emergency_insn.insn = INSN_WRITE;
+    emergency_insn.n = 1;
+    emergency_insn.data = &emergency_value;
+    emergency_insn.subdev = channel >> 8;
+    emergency_insn.chanspec = CR_PACK(channel & 0xff, 0, AREF_GROUND);
+    emergency_fd = comedi_fileno(emergency_it);
+
+    return emergency_fd >= 0;
+}
+
+
+
+void io_emergency_write() {
+    if (emergency_fd >= 0)
+        ioctl(emergency_fd, COMEDI_INSN, &emergency_insn);
+}
+
+
+
+static int io_stream_open(IoStream *stream, unsigned int period_ns) {
+    unsigned int chanlist[IO_STREAM_INPUTS];
+    comedi_cmd cmd;
+
+    for (unsigned int i = 0; i < IO_STREAM_INPUTS; i++)
+        chanlist[i] = CR_PACK(stream->first_input + i, 0, AREF_GROUND);
+
+    stream->it = comedi_open("/dev/comedi0");
+    if (stream->it == NULL)
+        return 0;
+
+    // A sample too narrow for the highest input channel would read it as 0.
+    int flags = comedi_get_subdevice_flags(stream->it, stream->subdevice);
+    unsigned int sample_size = (flags >= 0 && (flags & SDF_LSAMPL)) ? sizeof(lsampl_t) : sizeof(sampl_t);
+    if (flags < 0 || stream->first_input + IO_STREAM_INPUTS > sample_size * 8)
+        goto fail;
+
+    if (comedi_set_read_subdevice(stream->it, stream->subdevice) < 0
+        || comedi_get_cmd_generic_timed(stream->it, stream->subdevice, &cmd, IO_STREAM_INPUTS, period_ns) < 0)
+        goto fail;
+
+    cmd.chanlist = chanlist;
+    cmd.chanlist_len = IO_STREAM_INPUTS;
+    cmd.stop_src = TRIG_NONE;
+    cmd.stop_arg = 0;
+
+    // The first test may adjust the arguments, the second must accept them.
+    comedi_command_test(stream->it, &cmd);
+    if (comedi_command_test(stream->it, &cmd) != 0)
+        goto fail;
+
+    int size = comedi_get_buffer_size(stream->it, stream->subdevice);
+    if (size <= 0)
+        goto fail;
+
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, comedi_fileno(stream->it), 0);
+    if (map == MAP_FAILED)
+        goto fail;
+
+    if (comedi_command(stream->it, &cmd) < 0) {
+        munmap(map, size);
+        goto fail;
+    }
+
+    stream->buffer = map;
+    stream->buffer_size = size;
+    stream->sample_size = sample_size;
+    comedi_dio_bitfield2(it_g, stream->subdevice, 0, &stream->level, 0);
+    stream->seen = stream->level;
+    stream->active = 1;
+    return 1;
+
+fail:
+    comedi_close(stream->it);
+    stream->it = NULL;
+    return 0;
+}
+
+
+
+// Ends a stream that has stopped, after an error or a buffer overrun, so
+// its inputs are polled again.
+static void io_stream_stop(IoStream *stream) {
+    fprintf(stderr, "io: input stream on subdevice %d stopped, polling instead\n", stream->subdevice);
+    munmap((void *)stream->buffer, stream->buffer_size);
+    comedi_close(stream->it);
+    stream->it = NULL;
+    stream->active = 0;
+}
+
+
+
+int io_stream_start(unsigned int period_ns) {
+    int started = 0;
+
+    for (unsigned int i = 0; i < IO_STREAMS; i++) {
+        if (!streams[i].active)
+            started |= io_stream_open(&streams[i], period_ns);
+    }
+
+    return started;
+}
+
+
+
+void io_stream_update() {
+    for (unsigned int i = 0; i < IO_STREAMS; i++) {
+        IoStream *stream = &streams[i];
+        if (!stream->active)
+            continue;
+
+        int bytes = comedi_get_buffer_contents(stream->it, stream->subdevice);
+        int offset = comedi_get_buffer_offset(stream->it, stream->subdevice);
+        if (bytes < 0 || offset < 0) {
+            io_stream_stop(stream);
+            continue;
+        }
+        unsigned int samples = bytes / stream->sample_size;
+        if (samples == 0) {
+            int flags = comedi_get_subdevice_flags(stream->it, stream->subdevice);
+            if (flags < 0 || !(flags & SDF_RUNNING))
+                io_stream_stop(stream);
+            else
+                stream->seen = stream->level;
+            continue;
+        }
+
+        unsigned int seen = 0;
+        for (unsigned int n = 0; n < samples; n++) {
+            const unsigned char *sample = stream->buffer
+                + (offset + n * stream->sample_size) % stream->buffer_size;
+            stream->level = stream->sample_size == sizeof(lsampl_t)
+                ? *(const lsampl_t *)sample : *(const sampl_t *)sample;
+            seen |= stream->level;
+        }
+        stream->seen = seen;
+
+        if (comedi_mark_buffer_read(stream->it, stream->subdevice, samples * stream->sample_size) < 0)
+            io_stream_stop(stream);
+    }
+}
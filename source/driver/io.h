@@ -58,5 +58,47 @@ int io_read_bit(int channel);
 */
 int io_read_analog(int channel);
 
+/**
+  Opens a handle of its own for io_emergency_write and encodes a write of 0
+  to @p channel on it in advance.
+  @param channel Analog channel to write to.
+  @return Non-zero on success and 0 on failure
+*/
+int io_emergency_init(int channel);
+
+
+
+/**
+  Writes 0 to the channel given to io_emergency_init with a single ioctl.
+  Safe to call from a signal handler, since it shares no state with the
+  other calls. Does nothing if io_emergency_init failed.
+*/
+void io_emergency_write();
+
+
+
+/**
+  Starts hardware-timed sampling of the digital input subdevices through
+  comedi commands. While streaming, io_read_bit on an input channel is
+  answered from the mmap'd acquisition buffer instead of the card.
+  Subdevices that do not support commands, or whose samples are too narrow
+  to hold all their input channels, keep being polled.
+  @param period_ns Sampling period in nanoseconds.
+  @return Non-zero if at least one subdevice is streaming, 0 otherwise.
+*/
+int io_stream_start(unsigned int period_ns);
+
+
+
+/**
+  Consumes the samples acquired since the last call. A button or the stop
+  button reads as 1 until the next call if it was high in any of those
+  samples, so presses shorter than a tick are not lost. Floor sensors and
+  obstruction read as in the newest sample. A stream that has stopped, after an
+  error or a buffer overrun, is closed and its inputs are polled again.
+  Call once per tick.
+*/
+void io_stream_update();
+
 #endif // #ifndef __INCLUDE_IO_H__
 
@@ -0,0 +1,67 @@
+// Wear and energy bookkeeping shared by the hardware backends.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "wear.h"
+
+#include <time.h>
+
+
+static HardwareWear counters;
+
+static HardwareMovement last_movement = HARDWARE_MOVEMENT_STOP;
+static HardwareMovement last_direction = HARDWARE_MOVEMENT_STOP;
+static unsigned long run_start_ms;
+static int last_floor = -1;
+
+
+
+static unsigned long wear_now_ms() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000UL + now.tv_nsec / 1000000;
+}
+
+
+
+void wear_record_movement(HardwareMovement movement) {
+    if (movement == last_movement)
+        return;
+
+    if (last_movement == HARDWARE_MOVEMENT_STOP) {
+        counters.motor_starts++;
+        run_start_ms = wear_now_ms();
+    }
+    else {
+        counters.powered_ms += wear_now_ms() - run_start_ms;
+        if (movement != HARDWARE_MOVEMENT_STOP)
+            run_start_ms = wear_now_ms();
+    }
+
+    if (movement != HARDWARE_MOVEMENT_STOP) {
+        if (last_direction != HARDWARE_MOVEMENT_STOP && movement != last_direction)
+            counters.reversals++;
+        last_direction = movement;
+    }
+
+    last_movement = movement;
+}
+
+
+
+void wear_record_floor_sensor(int floor, int value) {
+    if (!value || floor == last_floor)
+        return;
+
+    if (last_floor >= 0)
+        counters.floors_travelled++;
+    last_floor = floor;
+}
+
+
+
+void wear_read(HardwareWear *wear) {
+    *wear = counters;
+    if (last_movement != HARDWARE_MOVEMENT_STOP)
+        wear->powered_ms += wear_now_ms() - run_start_ms;
+}
@@ -0,0 +1,32 @@
+// Wear and energy bookkeeping shared by the hardware backends.
+#ifndef __INCLUDE_DRIVER_WEAR_H__
+#define __INCLUDE_DRIVER_WEAR_H__
+
+#include "hardware.h"
+
+
+
+/**
+  Records a motor command. Repeated commands are not counted twice.
+  @param movement Commanded movement.
+*/
+void wear_record_movement(HardwareMovement movement);
+
+
+
+/**
+  Records a floor sensor reading, counting every arrival at a new floor.
+  @param floor Floor of the sensor.
+  @param value Value read from the sensor.
+*/
+void wear_record_floor_sensor(int floor, int value);
+
+
+
+/**
+  Fills in the counters, including the current run if the motor is on.
+  @param wear Counters to fill in.
+*/
+void wear_read(HardwareWear *wear);
+
+#endif // #ifndef __INCLUDE_DRIVER_WEAR_H__
@@ -0,0 +1,509 @@
+#include <stdio.h>
+#include "fsm.h"
+#include "queue.h"
+#include "timer.h"
+#include "inject.h"
+#include "traffic.h"
+
+/**
+ * @brief tells which state the elevator is in
+ */
+static State current_state;
+
+/**
+ * @brief tells wich floor the elevator is in
+ */
+static int current_floor;
+
+/**
+ * @brief tells which direction the elevator is moving in. 
+ */
+static HardwareMovement current_direction;
+
+/**
+ * @brief which way the car last moved. Tells which side of current_floor
+ * it is on when it has stopped between floors.
+ */
+static HardwareMovement last_motion;
+
+/**
+ * @brief tells whether the car was stopped between floors, by the stop button
+ * or the watchdog, and has not reached a floor since.
+ */
+static int between_floors;
+
+/**
+ * @brief tells whether the watchdog has put the controller in degraded mode,
+ * where lights and traffic statistics are not updated.
+ */
+static int degraded;
+
+/**
+ * @brief load in percent of rated load above which hall calls are passed by.
+ */
+#define FULL_LOAD_PERCENT 80
+
+/**
+ * @brief when the elevator last stopped at the ground floor, and the stops
+ * made and hall calls passed by since. One round trip runs from ground floor
+ * to ground floor.
+ */
+static unsigned int trip_start_ms;
+static int trip_stops;
+static int trip_bypassed;
+
+/**
+ * @brief the floor whose hall call was last passed by, so each pass is counted once.
+ */
+static int bypassed_floor;
+
+/**
+ * @brief adds elements to queue, both from buttons and injected calls.
+ */
+void poll_order(){
+    inject_poll(current_floor, degraded);
+    for(int f = 0; f<HARDWARE_NUMBER_OF_FLOORS; f++){
+        for(HardwareOrder i = HARDWARE_ORDER_UP; i<= HARDWARE_ORDER_DOWN; i++){
+            if(hardware_read_order(f,i)){
+                queue_set_order(f,i);
+                if(!degraded){
+                    hardware_command_order_light(f,i, 1);
+                }
+            }
+        }
+    }
+}
+
+/** 
+ * @brief updates current_floor and sets orderlight. A car at a floor is no
+ * longer between floors.
+ */
+void poll_floor_sensors(){
+    for(int f = 0; f < HARDWARE_NUMBER_OF_FLOORS; f++){
+        if(hardware_read_floor_sensor(f)){
+            current_floor = f;
+            between_floors = 0;
+            if(!degraded){
+                hardware_command_floor_indicator_on(f);
+            }
+        }
+    }
+}
+
+/**
+ * @brief clear all order lights
+ */
+static void clear_all_order_lights(){
+    HardwareOrder order_types[3] = {
+        HARDWARE_ORDER_UP,
+        HARDWARE_ORDER_INSIDE,
+        HARDWARE_ORDER_DOWN
+    };
+
+    for(int f = 0; f < HARDWARE_NUMBER_OF_FLOORS; f++){
+        for(int i = 0; i < 3; i++){
+            HardwareOrder type = order_types[i];
+            hardware_command_order_light(f, type, 0);
+        }
+    }
+}
+
+void fsm_refresh_lights(){
+    for(int f = 0; f < HARDWARE_NUMBER_OF_FLOORS; f++){
+        hardware_command_order_light(f, HARDWARE_ORDER_UP, queue_hall_call_at(f, HARDWARE_MOVEMENT_UP));
+        hardware_command_order_light(f, HARDWARE_ORDER_DOWN, queue_hall_call_at(f, HARDWARE_MOVEMENT_DOWN));
+        hardware_command_order_light(f, HARDWARE_ORDER_INSIDE, queue_car_call_at(f));
+    }
+    hardware_command_floor_indicator_on(current_floor);
+}
+
+/**
+ * @brief what to do when emergency stopp i called. Stops elevator and turn on stoplight,
+ */
+
+int emergency_stop(){
+    if(hardware_read_stop_signal()){
+        hardware_command_movement(HARDWARE_MOVEMENT_STOP);
+        hardware_command_stop_light(1);
+        current_state = EMERGENCY;
+        return 1;
+    }
+    return 0;
+}
+
+/** 
+ * @brief goes to first floor
+ */
+void go_to_first_floor(){
+    while (hardware_read_floor_sensor(0) == 0){ 
+        hardware_command_movement(HARDWARE_MOVEMENT_DOWN);
+        hardware_tick();
+    }
+    hardware_command_movement(HARDWARE_MOVEMENT_STOP);
+    current_floor = 0;
+    current_direction = HARDWARE_MOVEMENT_DOWN;
+    last_motion = HARDWARE_MOVEMENT_DOWN;
+    trip_start_ms = timer_now_ms();
+    hardware_command_floor_indicator_on(0);
+    timer_start();
+    current_state = OPEN_DOOR;
+    hardware_command_door_open(1);
+}
+
+/**
+ * @brief turns off light at @p floor
+ * @param floor which floor we are in.
+ */
+void turn_off_lights(int floor){
+    for (HardwareOrder f = HARDWARE_ORDER_UP; f <= HARDWARE_ORDER_DOWN; f++){
+        hardware_command_order_light(floor, f, 0);
+    }
+}
+
+/**
+ * @brief starts driving in @p direction.
+ * @param direction HARDWARE_MOVEMENT_UP or HARDWARE_MOVEMENT_DOWN.
+ */
+void drive(HardwareMovement direction){
+    hardware_command_movement(direction);
+    current_direction = direction;
+    last_motion = direction;
+    current_state = DRIVING;
+}
+
+/**
+ * @brief checks if there is any order above the car. When it has stopped
+ * between floors above current_floor, an order there is below it.
+ * @return true(1) or false(0).
+ */
+int order_above(){
+    int above = between_floors && last_motion == HARDWARE_MOVEMENT_UP;
+    return queue_order_above(above ? current_floor + 1 : current_floor);
+}
+
+/**
+ * @brief checks if there is any order below the car. When it has stopped
+ * between floors below current_floor, an order there is above it.
+ * @return true(1) or false(0).
+ */
+int order_below(){
+    int below = between_floors && last_motion == HARDWARE_MOVEMENT_DOWN;
+    return queue_order_below(below ? current_floor - 1 : current_floor);
+}
+
+/**
+ * @brief how long an idle elevator waits after the first call before it
+ * departs, so calls arriving close together are served in one run.
+ * Bounds the extra wait; 0 departs at once.
+ */
+#ifndef DEPART_COALESCE_MS
+#define DEPART_COALESCE_MS 0
+#endif
+
+/**
+ * @brief how long the elevator stays idle before it moves to the parking floor.
+ */
+#define PARK_DELAY_MS 10000
+
+/**
+ * @brief tells whether the queue was empty on the last tick in STANDBY.
+ */
+static int idle;
+
+/**
+ * @brief when the elevator last became idle.
+ */
+static unsigned int idle_since_ms;
+
+/**
+ * @brief applies the policy of the current traffic regime while there are no orders.
+ * Turns towards the preferred direction right away, and after @c PARK_DELAY_MS
+ * places a parking target at the parking floor.
+ */
+void park(){
+    TrafficPolicy policy = traffic_policy();
+    if (!idle){
+        idle = 1;
+        idle_since_ms = timer_now_ms();
+        if (policy.direction != HARDWARE_MOVEMENT_STOP){
+            current_direction = policy.direction;
+        }
+        return;
+    }
+    if (timer_now_ms() - idle_since_ms >= PARK_DELAY_MS
+        && policy.park_floor >= 0 && policy.park_floor != current_floor){
+        queue_set_park(policy.park_floor);
+    }
+}
+
+/**
+ * @brief checks if an overdue call lies further ahead in the direction of travel.
+ * Intermediate stops are skipped until it is served.
+ * @return true(1) or false(0).
+ */
+int overdue_ahead(){
+    int overdue = queue_overdue_floor();
+    if (overdue < 0){
+        return 0;
+    }
+    if (current_direction == HARDWARE_MOVEMENT_UP){
+        return overdue > current_floor;
+    }
+    return overdue < current_floor;
+}
+
+/**
+ * @brief checks if there is any order further ahead in the direction of travel.
+ * @return true(1) or false(0).
+ */
+int order_ahead(){
+    if (current_direction == HARDWARE_MOVEMENT_UP){
+        return queue_order_above(current_floor + 1);
+    }
+    return queue_order_below(current_floor - 1);
+}
+
+/**
+ * @brief checks if the hall call at the current floor should be left for a later
+ * pass because the car is full. Never done if someone in the car wants off here,
+ * or for the last order in the direction of travel.
+ * @return true(1) or false(0).
+ */
+int full_car_bypass(){
+    if (!queue_hall_call_at(current_floor, HARDWARE_MOVEMENT_UP) && !queue_hall_call_at(current_floor, HARDWARE_MOVEMENT_DOWN)){
+        return 0;
+    }
+    if (queue_car_call_at(current_floor) || hardware_read_load() < FULL_LOAD_PERCENT){
+        return 0;
+    }
+    int ahead = order_ahead();
+    if (ahead && bypassed_floor != current_floor){
+        bypassed_floor = current_floor;
+        trip_bypassed++;
+    }
+    return ahead;
+}
+
+/**
+ * @brief checks if the car should stop at current_floor. Destination calls
+ * going against the direction of travel cannot board, so they are left for
+ * the way back while there are orders ahead.
+ * @return true(1) or false(0).
+ */
+int stop_here(){
+    HardwareMovement against = current_direction == HARDWARE_MOVEMENT_UP ? HARDWARE_MOVEMENT_DOWN : HARDWARE_MOVEMENT_UP;
+    if (queue_order_at(current_floor, current_direction)){
+        return 1;
+    }
+    if (!queue_order_at(current_floor, against)){
+        return 0;
+    }
+    return !queue_destination_call_at(current_floor, against) || !order_ahead();
+}
+
+/**
+ * @brief reports a finished round trip on stdout as a line starting with "trip:".
+ */
+void report_trip(){
+    unsigned int now = timer_now_ms();
+    printf("trip: %u round_trip_ms=%u stops=%d bypassed=%d\n",
+        now, now - trip_start_ms, trip_stops, trip_bypassed);
+    fflush(stdout);
+    trip_start_ms = now;
+    trip_stops = 0;
+    trip_bypassed = 0;
+}
+
+/**
+ * @brief what to do when at right @p floor. Car calls of passengers who
+ * entered their destination on the hall panel are lit as they board.
+ * @param floor which floor we are in.
+ */
+void stop_at_floor(int floor){
+    hardware_command_movement(HARDWARE_MOVEMENT_STOP);
+    trip_stops++;
+    bypassed_floor = -1;
+    between_floors = 0;
+    if (floor == 0){
+        report_trip();
+    }
+    HardwareMovement against = current_direction == HARDWARE_MOVEMENT_UP ? HARDWARE_MOVEMENT_DOWN : HARDWARE_MOVEMENT_UP;
+    if (!queue_order_at(floor, current_direction) && !order_ahead()){
+        current_direction = against;
+        against = current_direction == HARDWARE_MOVEMENT_UP ? HARDWARE_MOVEMENT_DOWN : HARDWARE_MOVEMENT_UP;
+    }
+    queue_delete_element(floor, current_direction);
+    if (!degraded){
+        turn_off_lights(floor);
+        if (queue_hall_call_at(floor, against)){
+            hardware_command_order_light(floor, against == HARDWARE_MOVEMENT_UP ? HARDWARE_ORDER_UP : HARDWARE_ORDER_DOWN, 1);
+        }
+        for (int f = 0; f < HARDWARE_NUMBER_OF_FLOORS; f++){
+            if (queue_car_call_at(f)){
+                hardware_command_order_light(f, HARDWARE_ORDER_INSIDE, 1);
+            }
+        }
+    }
+    hardware_command_door_open(1);
+    timer_start();
+    current_state = OPEN_DOOR;
+}
+
+void fsm_init(){
+    idle = 0;
+    degraded = 0;
+    between_floors = 0;
+    bypassed_floor = -1;
+    trip_stops = 0;
+    trip_bypassed = 0;
+    clear_all_order_lights();
+    go_to_first_floor();
+}
+
+void fsm_step(int degraded_mode){
+    degraded = degraded_mode;
+    switch (current_state)
+    {
+    case STANDBY:
+        if(emergency_stop()){
+            break;
+        }
+        poll_order();
+        poll_floor_sensors();
+        if (queue_empty()){
+            park();
+            break;
+        }
+        if (hardware_read_floor_sensor(current_floor) && stop_here()){
+            idle = 0;
+            stop_at_floor(current_floor);
+            break;
+        }
+        int age = queue_oldest(NULL);
+        if (idle && age >= 0 && age < DEPART_COALESCE_MS){
+            break;
+        }
+        idle = 0;
+        int overdue = queue_overdue_floor();
+        if (overdue > current_floor){
+            current_direction = HARDWARE_MOVEMENT_UP;
+        }
+        else if (overdue >= 0 && overdue < current_floor){
+            current_direction = HARDWARE_MOVEMENT_DOWN;
+        }
+        if (current_direction == HARDWARE_MOVEMENT_UP){
+            if (order_above()){
+                drive(HARDWARE_MOVEMENT_UP);
+                break;
+            }
+            if (order_below()){
+                drive(HARDWARE_MOVEMENT_DOWN);
+                break;
+            }
+        }
+        if (current_direction == HARDWARE_MOVEMENT_DOWN){
+            if(order_below()){
+                drive(HARDWARE_MOVEMENT_DOWN);
+                break;
+            }
+            if (order_above()) {
+                drive(HARDWARE_MOVEMENT_UP);
+                break;
+            }
+        }
+        break;
+    case DRIVING:
+        if(emergency_stop()){
+            break;
+        }
+        poll_order();
+        poll_floor_sensors();
+        if (overdue_ahead()){
+            break;
+        }
+        if (hardware_read_floor_sensor(current_floor) && full_car_bypass()){
+            break;
+        }
+        if (hardware_read_floor_sensor(current_floor) && stop_here()){
+            stop_at_floor(current_floor);
+            break;
+        }
+        if (hardware_read_floor_sensor(current_floor) && !order_ahead()){
+            hardware_command_movement(HARDWARE_MOVEMENT_STOP);
+            current_state = STANDBY;
+            break;
+        }
+        break;
+    case OPEN_DOOR:
+        if(emergency_stop()){
+            break;
+        }
+        poll_order();
+        if(hardware_read_obstruction_signal()){
+            timer_start();
+            break;
+        }
+        if(timer_less_than(3)){
+            hardware_command_door_open(0);  
+            current_state = STANDBY;
+            break;
+        }
+        break;
+    case EMERGENCY: 
+        queue_delete_all();
+        if(!degraded){
+            clear_all_order_lights();
+        }
+        if(hardware_read_floor_sensor(current_floor)){
+            hardware_command_door_open(1);
+            if (hardware_read_stop_signal() == 0){
+                timer_start();
+                hardware_command_stop_light(0);
+                current_state = OPEN_DOOR;
+                break;
+            }
+        }          
+        if (hardware_read_stop_signal()== 0){
+            between_floors = 1;
+            hardware_command_door_open(0);
+            hardware_command_stop_light(0);
+            current_state = STANDBY;
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void fsm_motor_stopped(){
+    if(current_state == DRIVING){
+        between_floors = !hardware_read_floor_sensor(current_floor);
+        current_state = STANDBY;
+    }
+}
+
+State fsm_state(){
+    return current_state;
+}
+
+int fsm_floor(){
+    return current_floor;
+}
+
+void fsm_tick(int degraded_mode, int tripped){
+    if (tripped){
+        hardware_command_movement(HARDWARE_MOVEMENT_STOP);
+    }
+    hardware_tick();
+    if (tripped){
+        fsm_motor_stopped();
+    }
+    if (!degraded_mode){
+        if (degraded){
+            fsm_refresh_lights();
+        }
+        traffic_classify();
+    }
+    fsm_step(degraded_mode);
+}
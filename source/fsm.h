@@ -0,0 +1,65 @@
+#ifndef FSM_H
+#define FSM_H
+/**
+ * @file
+ * @brief Finish State Machine, controlling and driving the elevator.
+ * Talks to the elevator only through hardware.h, so it can be driven
+ * by any backend.
+ */
+
+#include "hardware.h"
+
+/**
+ * @brief statetype used to tell which state the elevator is in.
+ */
+typedef enum {
+    STANDBY,
+    DRIVING,
+    OPEN_DOOR,
+    EMERGENCY,
+} State;
+
+/**
+ * @brief clears the lights and drives to the first floor. Must be called
+ * once before @c fsm_step, and may be called again to start over.
+ */
+void fsm_init();
+
+/**
+ * @brief runs one tick of the state machine.
+ * @param degraded_mode truthy to shed updates of lights and indicators.
+ */
+void fsm_step(int degraded_mode);
+
+/**
+ * @brief tells the state machine that the motor was stopped behind its back,
+ * so it leaves DRIVING and decides again.
+ */
+void fsm_motor_stopped();
+
+/**
+ * @brief sets every order light and the floor indicator from the queue,
+ * after updates were shed in degraded mode.
+ */
+void fsm_refresh_lights();
+
+/**
+ * @brief runs one tick of the control loop: stops the motor after a watchdog
+ * trip, ticks the hardware, restores the lights when degraded mode ends,
+ * classifies the traffic and steps the state machine.
+ * @param degraded_mode truthy to shed updates of lights, indicators and traffic statistics.
+ * @param tripped truthy if the watchdog stopped the motor since the last tick.
+ */
+void fsm_tick(int degraded_mode, int tripped);
+
+/**
+ * @brief which state the elevator is in.
+ */
+State fsm_state();
+
+/**
+ * @brief which floor the elevator was last at.
+ */
+int fsm_floor();
+
+#endif
@@ -0,0 +1,481 @@
+/**
+ * @file
+ * @brief Coverage-guided fuzzer for the state machine.
+ *
+ * Runs fsm.c and queue.c against the in-memory elevator in sim.h with
+ * randomized input scripts, and checks safety invariants after every tick.
+ * Scripts that reach new combinations of controller and elevator state
+ * are kept and mutated further. Besides the elevator inputs, a script can
+ * put the controller in degraded mode and stall the control loop long
+ * enough for the watchdog to stop the motor, as main.c does.
+ *
+ * Usage: fsm_fuzz [seconds] [seed]. Exits with 1 on the first violation,
+ * after printing the script that caused it.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fsm.h"
+#include "queue.h"
+#include "traffic.h"
+#include "watchdog.h"
+#include "fuzz/sim.h"
+
+/**
+ * @brief ticks per run, 300 seconds of simulated time.
+ */
+#define FUZZ_STEPS_PER_RUN 30000
+
+#define FUZZ_MAX_EVENTS 64
+
+#define FUZZ_CORPUS_SIZE 4096
+
+#define FUZZ_COVERAGE_SIZE (1 << 16)
+
+/**
+ * @brief ticks after the stop button is pressed by which the motor must be off.
+ */
+#define FUZZ_STOP_TICKS 1
+
+/**
+ * @brief how long a call may wait before it counts as never served, not
+ * counting time the door was obstructed, the car was full or the loop stalled.
+ */
+#define FUZZ_SERVE_BOUND_MS (QUEUE_MAX_WAIT_MS + 120000)
+
+#define FUZZ_SHAFT_TOP ((HARDWARE_NUMBER_OF_FLOORS - 1) * SIM_FLOOR_DISTANCE)
+
+/**
+ * @brief ticks a stalled loop goes without running before the watchdog stops the motor.
+ */
+#define FUZZ_TRIP_TICKS (WATCHDOG_MISSED_DEADLINES * WATCHDOG_TICK_BUDGET_US / (SIM_TICK_MS * 1000))
+
+typedef enum {
+    EVENT_ORDER,
+    EVENT_STOP,
+    EVENT_OBSTRUCTION,
+    EVENT_DROPOUT,
+    EVENT_LOAD,
+    EVENT_DEGRADED,
+    EVENT_STALL,
+    EVENT_KINDS
+} EventKind;
+
+/**
+ * @brief an input held for @c duration ticks from tick @c step.
+ */
+typedef struct {
+    int step;
+    int duration;
+    unsigned char kind;
+    unsigned char floor;
+    unsigned char order;
+    unsigned char load;
+} Event;
+
+/**
+ * @brief one run: where the car starts, and the inputs sorted by step.
+ */
+typedef struct {
+    int start_position;
+    int count;
+    Event events[FUZZ_MAX_EVENTS];
+} Script;
+
+static Script corpus[FUZZ_CORPUS_SIZE];
+
+static int corpus_count;
+
+static unsigned char coverage[FUZZ_COVERAGE_SIZE / 8];
+
+static int coverage_bits;
+
+static unsigned long long rng_state;
+
+static unsigned int fuzz_random(){
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (unsigned int)((rng_state * 2685821657736338717ULL) >> 32);
+}
+
+static int fuzz_below(int n){
+    return fuzz_random() % n;
+}
+
+static Event fuzz_random_event(){
+    Event event;
+    memset(&event, 0, sizeof(event));
+    event.step = fuzz_below(FUZZ_STEPS_PER_RUN);
+    event.kind = fuzz_below(EVENT_KINDS);
+    event.floor = fuzz_below(HARDWARE_NUMBER_OF_FLOORS);
+    event.order = fuzz_below(3);
+    event.load = fuzz_below(2) ? 100 : fuzz_below(100);
+
+    // Mostly short presses and blips, sometimes long holds.
+    switch (fuzz_below(4)){
+    case 0:
+        event.duration = 1 + fuzz_below(3);
+        break;
+    case 1:
+        event.duration = 1 + fuzz_below(50);
+        break;
+    case 2:
+        event.duration = 1 + fuzz_below(500);
+        break;
+    default:
+        event.duration = 1 + fuzz_below(5000);
+        break;
+    }
+    return event;
+}
+
+static int fuzz_compare_events(const void *a, const void *b){
+    return ((const Event *)a)->step - ((const Event *)b)->step;
+}
+
+/**
+ * @brief sorts the events, and keeps sensor dropouts to flickers shorter
+ * than the sensor window. A longer dropout hides a floor from any controller.
+ */
+static void fuzz_normalize(Script *script){
+    for (int i = 0; i < script->count; i++){
+        if (script->events[i].kind == EVENT_DROPOUT){
+            script->events[i].duration = 1 + script->events[i].duration % SIM_SENSOR_WIDTH;
+        }
+    }
+    qsort(script->events, script->count, sizeof(Event), fuzz_compare_events);
+}
+
+static void fuzz_random_script(Script *script){
+    script->start_position = fuzz_below(FUZZ_SHAFT_TOP + 1);
+    script->count = 1 + fuzz_below(FUZZ_MAX_EVENTS);
+    for (int i = 0; i < script->count; i++){
+        script->events[i] = fuzz_random_event();
+    }
+    fuzz_normalize(script);
+}
+
+static void fuzz_mutate(Script *script){
+    int mutations = 1 + fuzz_below(4);
+    for (int m = 0; m < mutations; m++){
+        int i = script->count > 0 ? fuzz_below(script->count) : 0;
+        switch (fuzz_below(6)){
+        case 0:
+            if (script->count < FUZZ_MAX_EVENTS){
+                script->events[script->count++] = fuzz_random_event();
+            }
+            break;
+        case 1:
+            if (script->count > 0){
+                script->events[i] = script->events[--script->count];
+            }
+            break;
+        case 2:
+            if (script->count > 0){
+                script->events[i].step += fuzz_below(201) - 100;
+                if (script->events[i].step < 0){
+                    script->events[i].step = 0;
+                }
+            }
+            break;
+        case 3:
+            if (script->count > 0){
+                script->events[i].duration = 1 + fuzz_below(script->events[i].duration * 2 + 1);
+            }
+            break;
+        case 4:
+            if (script->count > 0){
+                Event event = fuzz_random_event();
+                event.step = script->events[i].step;
+                script->events[i] = event;
+            }
+            break;
+        default:
+            script->start_position = fuzz_below(FUZZ_SHAFT_TOP + 1);
+            break;
+        }
+    }
+    fuzz_normalize(script);
+}
+
+static void fuzz_print_script(const Script *script){
+    static const char *kinds[] = {"order", "stop", "obstruction", "dropout", "load", "degraded", "stall"};
+    fprintf(stderr, "script: start_position=%d\n", script->start_position);
+    for (int i = 0; i < script->count; i++){
+        const Event *e = &script->events[i];
+        fprintf(stderr, "  step=%d duration=%d %s floor=%d order=%d load=%d\n",
+            e->step, e->duration, kinds[e->kind], e->floor, e->order, e->load);
+    }
+}
+
+/**
+ * @brief a call the fuzzer expects to be served.
+ */
+typedef struct {
+    int pending;
+    unsigned int placed_ms;
+    unsigned int excused_ms;    /**< value of excused_ms when it was placed */
+} Call;
+
+/**
+ * @brief one tick of the trace printed with a violation.
+ */
+typedef struct {
+    int step;
+    State state;
+    int floor;
+    int position;
+    HardwareMovement motor;
+    unsigned char door_open, stop, obstruction, sensor_dropout, load, degraded, stalled;
+} TraceEntry;
+
+#define FUZZ_TRACE_SIZE 64
+
+static TraceEntry trace[FUZZ_TRACE_SIZE];
+
+static void fuzz_print_trace(int last_step){
+    int first = last_step - FUZZ_TRACE_SIZE + 1;
+    for (int step = first < 0 ? 0 : first; step <= last_step; step++){
+        const TraceEntry *t = &trace[step % FUZZ_TRACE_SIZE];
+        fprintf(stderr, "  step=%d state=%d floor=%d position=%d motor=%d door=%d stop=%d obstruction=%d dropout=%d load=%d degraded=%d stalled=%d\n",
+            t->step, t->state, t->floor, t->position, t->motor, t->door_open, t->stop,
+            t->obstruction, t->sensor_dropout, t->load, t->degraded, t->stalled);
+    }
+}
+
+typedef struct {
+    const char *violation;
+    int step;
+    int new_coverage;
+} RunResult;
+
+static unsigned int fuzz_feature(int degraded, int stalled){
+    int floor = sim_floor();
+    return fsm_state()
+        | fsm_floor() << 2
+        | sim.motor << 4
+        | sim.door_open << 6
+        | sim.stop << 7
+        | sim.obstruction << 8
+        | (floor + 1) << 9
+        | sim.sensor_dropout << 12
+        | (sim.load >= 80) << 13
+        | (queue_oldest(NULL) >= 0) << 14
+        | degraded << 15
+        | stalled << 16;
+}
+
+static int fuzz_cover(unsigned int previous, unsigned int feature){
+    unsigned int edge = (previous * 0x9e3779b1u ^ feature) * 0x85ebca6bu;
+    edge = (edge ^ edge >> 16) & (FUZZ_COVERAGE_SIZE - 1);
+    if (coverage[edge >> 3] & (1 << (edge & 7))){
+        return 0;
+    }
+    coverage[edge >> 3] |= 1 << (edge & 7);
+    coverage_bits++;
+    return 1;
+}
+
+static RunResult fuzz_run(const Script *script){
+    RunResult result = {NULL, 0, 0};
+    int order_until[HARDWARE_NUMBER_OF_FLOORS][3];
+    int stop_until = 0;
+    int obstruction_until = 0;
+    int dropout_until = 0;
+    int load_until = 0;
+    int load = 0;
+    int degraded_until = 0;
+    int stall_until = 0;
+    int degraded = 0;
+    int stalled = 0;
+    int tripped = 0;
+    int stop_ticks = 0;
+    unsigned int excused_ms = 0;
+    Call calls[HARDWARE_NUMBER_OF_FLOORS][3];
+
+    memset(order_until, 0, sizeof(order_until));
+    memset(calls, 0, sizeof(calls));
+
+    sim_reset(script->start_position);
+    queue_delete_all();
+    traffic_reset();
+    fsm_init();
+
+    unsigned int previous = fuzz_feature(0, 0);
+    int next_event = 0;
+
+    for (int step = 0; step < FUZZ_STEPS_PER_RUN; step++){
+        for (; next_event < script->count && script->events[next_event].step <= step; next_event++){
+            const Event *e = &script->events[next_event];
+            int until = step + e->duration;
+            switch (e->kind){
+            case EVENT_ORDER:
+                order_until[e->floor][e->order] = until;
+                break;
+            case EVENT_STOP:
+                stop_until = until;
+                break;
+            case EVENT_OBSTRUCTION:
+                obstruction_until = until;
+                break;
+            case EVENT_DROPOUT:
+                dropout_until = until;
+                break;
+            case EVENT_DEGRADED:
+                degraded_until = until;
+                break;
+            case EVENT_STALL:
+                // Ticks over budget also put the controller in degraded mode.
+                if (stall_until <= step){
+                    stall_until = until;
+                    degraded_until = until + WATCHDOG_RECOVERY_TICKS;
+                }
+                break;
+            default:
+                load_until = until;
+                load = e->load;
+                break;
+            }
+        }
+
+        sim.stop = step < stop_until;
+        sim.obstruction = step < obstruction_until;
+        sim.sensor_dropout = step < dropout_until;
+        sim.load = step < load_until ? load : 0;
+
+        int running = step >= stall_until;
+        State before = fsm_state();
+        for (int f = 0; f < HARDWARE_NUMBER_OF_FLOORS; f++){
+            for (int o = 0; o < 3; o++){
+                int pressed = step < order_until[f][o];
+                sim.order_button[f][o] = pressed;
+                if (pressed && running && !calls[f][o].pending && !sim.stop && before != EMERGENCY
+                    && sim_legal_order(f, o)){
+                    calls[f][o] = (Call){1, sim.now_ms, excused_ms};
+                }
+            }
+        }
+
+        if (running){
+            degraded = step < degraded_until;
+            fsm_tick(degraded, tripped);
+            tripped = 0;
+            stalled = 0;
+        }
+        else{
+            hardware_tick();
+            if (++stalled == FUZZ_TRIP_TICKS){
+                hardware_emergency_stop();
+                tripped = 1;
+            }
+        }
+
+        trace[step % FUZZ_TRACE_SIZE] = (TraceEntry){step, fsm_state(), fsm_floor(), sim.position,
+            sim.motor, sim.door_open, sim.stop, sim.obstruction, sim.sensor_dropout, sim.load,
+            degraded, stalled > 0};
+
+        if (sim.obstruction || sim.load >= 80 || !running){
+            excused_ms += SIM_TICK_MS;
+        }
+        // A stalled loop cannot see the button; the watchdog bounds that time instead.
+        stop_ticks = sim.stop ? stop_ticks + running : 0;
+
+        if (sim.motor != HARDWARE_MOVEMENT_STOP && sim.door_open){
+            result.violation = "motor running with the door open";
+        }
+        else if (stop_ticks >= FUZZ_STOP_TICKS && sim.motor != HARDWARE_MOVEMENT_STOP){
+            result.violation = "motor still running after the stop button was pressed";
+        }
+        else if (sim.door_open && sim_floor() < 0){
+            result.violation = "door open between floors";
+        }
+        else if (sim.position < -SIM_FLOOR_DISTANCE / 2 || sim.position > FUZZ_SHAFT_TOP + SIM_FLOOR_DISTANCE / 2){
+            result.violation = "car left the shaft";
+        }
+
+        int floor = sim_floor();
+        for (int f = 0; f < HARDWARE_NUMBER_OF_FLOORS && !result.violation; f++){
+            for (int o = 0; o < 3; o++){
+                Call *call = &calls[f][o];
+                if (!call->pending){
+                    continue;
+                }
+                if (sim.stop || (sim.door_open && floor == f)){
+                    call->pending = 0;
+                }
+                else if (sim.now_ms - call->placed_ms - (excused_ms - call->excused_ms) > FUZZ_SERVE_BOUND_MS){
+                    result.violation = "call never served";
+                }
+            }
+        }
+
+        unsigned int feature = fuzz_feature(degraded, stalled > 0);
+        result.new_coverage |= fuzz_cover(previous, feature);
+        previous = feature;
+
+        if (result.violation){
+            result.step = step;
+            return result;
+        }
+    }
+    return result;
+}
+
+int main(int argc, char **argv){
+    double seconds = argc > 1 ? atof(argv[1]) : 10;
+    rng_state = argc > 2 ? strtoull(argv[2], NULL, 0) : (unsigned long long)time(NULL);
+    if (rng_state == 0){
+        rng_state = 1;
+    }
+    unsigned long long seed = rng_state;
+
+    // The controller reports trips and traffic on stdout; keep them out of the way.
+    if (!freopen("/dev/null", "w", stdout)){
+        return 2;
+    }
+    hardware_init();
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    unsigned long long runs = 0;
+    double elapsed = 0;
+    Script script;
+
+    while (elapsed < seconds){
+        if (corpus_count == 0 || fuzz_below(10) == 0){
+            fuzz_random_script(&script);
+        }
+        else{
+            script = corpus[fuzz_below(corpus_count)];
+            fuzz_mutate(&script);
+        }
+
+        RunResult result = fuzz_run(&script);
+        runs++;
+
+        if (result.violation){
+            fprintf(stderr, "violation: %s at step %d (seed %llu, run %llu)\n",
+                result.violation, result.step, seed, runs);
+            fuzz_print_script(&script);
+            fprintf(stderr, "trace:\n");
+            fuzz_print_trace(result.step);
+            return 1;
+        }
+        if (result.new_coverage){
+            corpus[corpus_count < FUZZ_CORPUS_SIZE ? corpus_count++ : fuzz_below(FUZZ_CORPUS_SIZE)] = script;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+    }
+
+    double steps = (double)runs * FUZZ_STEPS_PER_RUN;
+    fprintf(stderr, "runs=%llu steps=%.0f steps_per_s=%.0f corpus=%d coverage=%d seed=%llu\n",
+        runs, steps, steps / elapsed, corpus_count, coverage_bits, seed);
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef SIM_H
+#define SIM_H
+/**
+ * @file
+ * @brief In-memory elevator for running the state machine headless.
+ *
+ * Implements hardware.h and timer.h without any I/O: every
+ * @c hardware_tick advances simulated time by @c SIM_TICK_MS and moves
+ * the car one step. Inputs are set directly in @c sim.
+ */
+
+#include "hardware.h"
+
+/**
+ * @brief simulated time per tick in milliseconds.
+ */
+#define SIM_TICK_MS 10
+
+/**
+ * @brief ticks of travel between two floors.
+ */
+#define SIM_FLOOR_DISTANCE 200
+
+/**
+ * @brief how many ticks of travel either side of a floor its sensor is active.
+ */
+#define SIM_SENSOR_WIDTH 5
+
+/**
+ * @brief state of the simulated elevator.
+ */
+typedef struct {
+    unsigned int now_ms;
+    unsigned int timer_start_ms;
+    int position;                   /**< ticks of travel above the first floor */
+
+    HardwareMovement motor;
+    int door_open;
+    int stop_light;
+    int floor_indicator;
+    int order_light[HARDWARE_NUMBER_OF_FLOORS][3];
+
+    int order_button[HARDWARE_NUMBER_OF_FLOORS][3];
+    int stop;
+    int obstruction;
+    int sensor_dropout;             /**< all floor sensors read 0 while set */
+    int load;
+} Sim;
+
+extern Sim sim;
+
+/**
+ * @brief puts the car at @p position with everything off and the clock at 0.
+ */
+void sim_reset(int position);
+
+/**
+ * @brief the floor the car is at, -1 if it is between floors. Ignores dropouts.
+ */
+int sim_floor();
+
+/**
+ * @brief checks if the panel has a button for @p order_type at @p floor, as
+ * hardware_legal_floor() does for the real driver. There is no down button at
+ * the ground floor and no up button at the top floor.
+ * @return true(1) or false(0).
+ */
+int sim_legal_order(int floor, HardwareOrder order_type);
+
+#endif
@@ -0,0 +1,118 @@
+#include "sim.h"
+#include "timer.h"
+
+#include <string.h>
+
+Sim sim;
+
+void sim_reset(int position){
+    memset(&sim, 0, sizeof(sim));
+    sim.position = position;
+    sim.motor = HARDWARE_MOVEMENT_STOP;
+}
+
+int sim_floor(){
+    int floor = (sim.position + SIM_FLOOR_DISTANCE / 2) / SIM_FLOOR_DISTANCE;
+    int offset = sim.position - floor * SIM_FLOOR_DISTANCE;
+    if (floor >= HARDWARE_NUMBER_OF_FLOORS || offset < -SIM_SENSOR_WIDTH || offset > SIM_SENSOR_WIDTH){
+        return -1;
+    }
+    return floor;
+}
+
+int sim_legal_order(int floor, HardwareOrder order_type){
+    if (floor < 0 || floor >= HARDWARE_NUMBER_OF_FLOORS){
+        return 0;
+    }
+    if (floor == 0 && order_type == HARDWARE_ORDER_DOWN){
+        return 0;
+    }
+    if (floor == HARDWARE_NUMBER_OF_FLOORS - 1 && order_type == HARDWARE_ORDER_UP){
+        return 0;
+    }
+    return 1;
+}
+
+int hardware_init(){
+    return 0;
+}
+
+void hardware_tick(){
+    sim.now_ms += SIM_TICK_MS;
+    if (sim.motor == HARDWARE_MOVEMENT_UP){
+        sim.position++;
+    }
+    if (sim.motor == HARDWARE_MOVEMENT_DOWN){
+        sim.position--;
+    }
+}
+
+void hardware_read_latency(HardwareLatency *latency){
+    memset(latency, 0, sizeof(*latency));
+}
+
+void hardware_read_wear(HardwareWear *wear){
+    memset(wear, 0, sizeof(*wear));
+}
+
+void hardware_command_movement(HardwareMovement movement){
+    sim.motor = movement;
+}
+
+void hardware_emergency_stop(){
+    sim.motor = HARDWARE_MOVEMENT_STOP;
+}
+
+int hardware_read_stop_signal(){
+    return sim.stop;
+}
+
+int hardware_read_obstruction_signal(){
+    return sim.obstruction;
+}
+
+int hardware_read_floor_sensor(int floor){
+    return !sim.sensor_dropout && floor == sim_floor();
+}
+
+int hardware_read_load(){
+    return sim.load;
+}
+
+int hardware_read_order(int floor, HardwareOrder order_type){
+    if (!sim_legal_order(floor, order_type)){
+        return 0;
+    }
+    return sim.order_button[floor][order_type];
+}
+
+void hardware_command_door_open(int door_open){
+    sim.door_open = door_open != 0;
+}
+
+void hardware_command_floor_indicator_on(int floor){
+    sim.floor_indicator = floor;
+}
+
+void hardware_command_stop_light(int on){
+    sim.stop_light = on != 0;
+}
+
+void hardware_command_order_light(int floor, HardwareOrder order_type, int on){
+    if (!sim_legal_order(floor, order_type)){
+        return;
+    }
+    sim.order_light[floor][order_type] = on != 0;
+}
+
+void timer_start(){
+    sim.timer_start_ms = sim.now_ms;
+}
+
+int timer_less_than(int sec){
+    return sim.now_ms - sim.timer_start_ms >= (unsigned int)sec * 1000;
+}
+
+unsigned int timer_now_ms(){
+    return sim.now_ms;
+}
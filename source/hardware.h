@@ -30,6 +30,28 @@ typedef enum {
     HARDWARE_ORDER_DOWN
 } HardwareOrder;
 
+/**
+ * @brief Wear and energy counters kept by the driver, read
+ * with @c hardware_read_wear.
+ */
+typedef struct {
+    unsigned long motor_starts;
+    unsigned long reversals;
+    unsigned long floors_travelled;
+    unsigned long powered_ms;
+} HardwareWear;
+
+/**
+ * @brief Round trip times of the synchronizations with the
+ * hardware, read with @c hardware_read_latency.
+ */
+typedef struct {
+    unsigned long round_trips;
+    long last_us;
+    long mean_us;
+    long worst_us;
+} HardwareLatency;
+
 /**
  * @brief Initializes the elevator control hardware.
  * Must be called once before other calls to the elevator
@@ -39,6 +61,22 @@ typedef enum {
  */
 int hardware_init();
 
+/**
+ * @brief Synchronizes the driver with the hardware. Must be called
+ * once per iteration of the control loop. Backends that batch their
+ * I/O send pending commands and refresh their inputs here; other
+ * backends do nothing.
+ */
+void hardware_tick();
+
+/**
+ * @brief Reads the round trip times of @c hardware_tick in
+ * microseconds. All zero if the backend does not batch its I/O.
+ *
+ * @param latency Times to fill in.
+ */
+void hardware_read_latency(HardwareLatency *latency);
+
 /**
  * @brief Commands the elevator to either move up or down,
  * or commands it to halt.
@@ -47,6 +85,26 @@ int hardware_init();
  */
 void hardware_command_movement(HardwareMovement movement);
 
+/**
+ * @brief Stops the motor from a signal handler. Writes a
+ * pre-encoded stop on a connection to the hardware of its own,
+ * opened by @c hardware_init, and shares no state with the other
+ * calls. The wear counters and any cached outputs do not see
+ * this stop, so the control loop must still command
+ * @c HARDWARE_MOVEMENT_STOP once it runs again. Does nothing if
+ * that connection could not be opened.
+ */
+void hardware_emergency_stop();
+
+/**
+ * @brief Reads the wear counters: motor starts, changes of
+ * direction between runs, floors travelled and time with the
+ * motor powered.
+ *
+ * @param wear Counters to fill in.
+ */
+void hardware_read_wear(HardwareWear *wear);
+
 /**
  * @brief Polls the hardware for the current stop signal.
  *
@@ -70,6 +128,14 @@ int hardware_read_obstruction_signal();
  */
 int hardware_read_floor_sensor(int floor);
 
+/**
+ * @brief Polls the load weighing cell of the car.
+ *
+ * @return Load as a percentage of the rated load, 0 if the
+ * backend has no load cell.
+ */
+int hardware_read_load();
+
 /**
  * @brief Polls the hardware for the status of orders from
  * floor @p floor of type @p order_type.
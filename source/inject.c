@@ -0,0 +1,192 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "inject.h"
+#include "queue.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define INJECT_FLOOR_TRAVEL_SEC 3
+#define INJECT_DOOR_OPEN_SEC 3
+
+static InjectRing *ring = NULL;
+
+static int sock_fd = -1;
+
+static int inject_legal_call(const InjectCall *call){
+    if(call->floor < 0 || call->floor >= HARDWARE_NUMBER_OF_FLOORS){
+        return 0;
+    }
+    if(call->destination != INJECT_NO_DESTINATION){
+        return call->destination >= 0 && call->destination < HARDWARE_NUMBER_OF_FLOORS
+            && call->destination != call->floor;
+    }
+    if(call->order < HARDWARE_ORDER_UP || call->order > HARDWARE_ORDER_DOWN){
+        return 0;
+    }
+    if(call->floor == 0 && call->order == HARDWARE_ORDER_DOWN){
+        return 0;
+    }
+    if(call->floor == HARDWARE_NUMBER_OF_FLOORS - 1 && call->order == HARDWARE_ORDER_UP){
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief rough ETA: travel time to @p target plus a door cycle for every
+ * queued stop on the way.
+ */
+static int inject_eta(int floor, int target){
+    int step = target > floor ? 1 : -1;
+    int eta = abs(target - floor) * INJECT_FLOOR_TRAVEL_SEC;
+    for(int f = floor; f != target; f += step){
+        if(queue_order_at(f, HARDWARE_MOVEMENT_UP) || queue_order_at(f, HARDWARE_MOVEMENT_DOWN)){
+            eta += INJECT_DOOR_OPEN_SEC;
+        }
+    }
+    return eta;
+}
+
+/**
+ * @brief copies a call out of the shared ring. The client can still write the
+ * slot, so each field is read exactly once and only the copy is checked and used.
+ */
+static InjectCall inject_read_call(const volatile InjectCall *slot){
+    InjectCall call;
+    call.id = slot->id;
+    call.floor = slot->floor;
+    call.order = slot->order;
+    call.destination = slot->destination;
+    return call;
+}
+
+static InjectAck inject_accept(const InjectCall *call, int floor, int degraded){
+    InjectAck ack = {call->id, -1, 0};
+    if(!inject_legal_call(call)){
+        return ack;
+    }
+    ack.eta_sec = inject_eta(floor, call->floor);
+    ack.car = 0;
+    if(call->destination != INJECT_NO_DESTINATION){
+        HardwareOrder order = call->destination > call->floor ? HARDWARE_ORDER_UP : HARDWARE_ORDER_DOWN;
+        queue_set_destination(call->floor, call->destination);
+        if(!degraded){
+            hardware_command_order_light(call->floor, order, 1);
+        }
+    }
+    else{
+        queue_set_order(call->floor, call->order);
+        if(!degraded){
+            hardware_command_order_light(call->floor, call->order, 1);
+        }
+    }
+    return ack;
+}
+
+static int inject_open_ring(){
+    int fd = shm_open(INJECT_SHM_NAME, O_RDWR | O_CREAT, 0660);
+    if(fd < 0){
+        return 0;
+    }
+    if(ftruncate(fd, sizeof(InjectRing)) != 0){
+        close(fd);
+        return 0;
+    }
+    void *map = mmap(NULL, sizeof(InjectRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED){
+        return 0;
+    }
+    ring = map;
+    atomic_store_explicit(&ring->call_tail, atomic_load(&ring->call_head), memory_order_release);
+    atomic_store_explicit(&ring->ack_head, atomic_load(&ring->ack_tail), memory_order_release);
+    return 1;
+}
+
+static int inject_open_socket(){
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, INJECT_SOCKET_PATH, sizeof(addr.sun_path) - 1);
+
+    sock_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if(sock_fd < 0){
+        return 0;
+    }
+    unlink(INJECT_SOCKET_PATH);
+    if(bind(sock_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0
+        || fcntl(sock_fd, F_SETFL, O_NONBLOCK) != 0){
+        close(sock_fd);
+        sock_fd = -1;
+        return 0;
+    }
+    return 1;
+}
+
+int inject_init(){
+    int ring_ok = inject_open_ring();
+    int sock_ok = inject_open_socket();
+    return !(ring_ok || sock_ok);
+}
+
+static void inject_poll_ring(int floor, int degraded){
+    unsigned int head = atomic_load_explicit(&ring->call_head, memory_order_acquire);
+    unsigned int tail = atomic_load_explicit(&ring->call_tail, memory_order_relaxed);
+    unsigned int ack_head = atomic_load_explicit(&ring->ack_head, memory_order_relaxed);
+    unsigned int ack_tail = atomic_load_explicit(&ring->ack_tail, memory_order_acquire);
+
+    /* the client owns call_head; one further than a ring ahead is corrupt, drop it all */
+    if(head - tail > INJECT_RING_SIZE){
+        tail = head;
+    }
+    for(; tail != head && ack_head - ack_tail < INJECT_RING_SIZE; tail++){
+        InjectCall call = inject_read_call(&ring->calls[tail & (INJECT_RING_SIZE - 1)]);
+        ring->acks[ack_head & (INJECT_RING_SIZE - 1)] = inject_accept(&call, floor, degraded);
+        ack_head++;
+    }
+
+    atomic_store_explicit(&ring->call_tail, tail, memory_order_release);
+    atomic_store_explicit(&ring->ack_head, ack_head, memory_order_release);
+}
+
+static void inject_poll_socket(int floor, int degraded){
+    InjectCall calls[INJECT_MAX_BATCH];
+    InjectAck acks[INJECT_MAX_BATCH];
+    struct sockaddr_un from;
+
+    for(int datagrams = 0; datagrams < INJECT_MAX_DATAGRAMS; datagrams++){
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(sock_fd, calls, sizeof(calls), 0, (struct sockaddr *)&from, &from_len);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return;
+        }
+
+        int count = n / sizeof(InjectCall);
+        for(int i = 0; i < count; i++){
+            acks[i] = inject_accept(&calls[i], floor, degraded);
+        }
+        if(count > 0 && from_len > sizeof(sa_family_t)){
+            sendto(sock_fd, acks, count * sizeof(InjectAck), MSG_DONTWAIT, (struct sockaddr *)&from, from_len);
+        }
+    }
+}
+
+void inject_poll(int floor, int degraded){
+    if(ring){
+        inject_poll_ring(floor, degraded);
+    }
+    if(sock_fd >= 0){
+        inject_poll_socket(floor, degraded);
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef INJECT_H
+#define INJECT_H
+/**
+ * @file
+ * @brief Local API for injecting hall and car calls without pressing buttons.
+ *
+ * Calls can be submitted in two ways:
+ * - through a lock-free single-producer/single-consumer ring in the shared
+ *   memory object @c INJECT_SHM_NAME, for high-rate local clients.
+ * - as batched datagrams on the UNIX socket @c INJECT_SOCKET_PATH, for
+ *   clients that can not map shared memory or when several clients are active.
+ *
+ * Each accepted call is answered with an @c InjectAck carrying the
+ * assigned car and an estimated time of arrival.
+ */
+
+#include <stdatomic.h>
+#include "hardware.h"
+
+#define INJECT_SHM_NAME "/heislab_inject"
+#define INJECT_SOCKET_PATH "/tmp/heislab_inject.sock"
+
+/**
+ * @brief number of slots in each ring. Must be a power of two.
+ */
+#define INJECT_RING_SIZE 4096
+
+/**
+ * @brief most calls accepted in one socket datagram.
+ */
+#define INJECT_MAX_BATCH 256
+
+/**
+ * @brief most socket datagrams handled in one tick. The rest wait for the next
+ * tick, so a flooding client cannot hold up the state machine.
+ */
+#define INJECT_MAX_DATAGRAMS 8
+
+#define INJECT_NO_DESTINATION -1
+
+/**
+ * @brief a call submitted by a client. Conventional calls give a floor and a
+ * button; destination calls, from destination dispatch panels, give the
+ * floor the passenger is waiting at and the floor they are going to.
+ */
+typedef struct {
+    unsigned int id;        /**< chosen by the client, echoed in the ack */
+    int floor;
+    HardwareOrder order;    /**< ignored for destination calls */
+    int destination;        /**< target floor of a destination call, @c INJECT_NO_DESTINATION otherwise */
+} InjectCall;
+
+/**
+ * @brief answer to an @c InjectCall.
+ */
+typedef struct {
+    unsigned int id;
+    int car;                /**< assigned car, -1 if the call was rejected */
+    int eta_sec;            /**< estimated seconds until the car arrives */
+} InjectAck;
+
+/**
+ * @brief layout of the shared memory object.
+ *
+ * The client is the only writer of @c call_head and @c ack_tail, the
+ * elevator is the only writer of @c call_tail and @c ack_head. The indices
+ * run freely and are masked with @c INJECT_RING_SIZE - 1 on access.
+ * Every call read gets an ack. While the ack ring is full, no calls are
+ * read, so they wait in the call ring until the client has taken acks.
+ */
+typedef struct {
+    _Alignas(64) atomic_uint call_head;
+    _Alignas(64) atomic_uint call_tail;
+    _Alignas(64) atomic_uint ack_head;
+    _Alignas(64) atomic_uint ack_tail;
+    InjectCall calls[INJECT_RING_SIZE];
+    InjectAck acks[INJECT_RING_SIZE];
+} InjectRing;
+
+/**
+ * @brief creates the shared memory ring and binds the socket.
+ * @return 0 on success. Non-zero if neither path could be opened.
+ */
+int inject_init();
+
+/**
+ * @brief merges pending injected calls into the queue and sends the acks.
+ * Drains the ring, and reads at most @c INJECT_MAX_DATAGRAMS datagrams from
+ * the socket. Meant to be called once per tick.
+ * @param floor Which floor the elevator is in, used for the ETA.
+ * @param degraded Non-zero in degraded mode, where the call lights are left alone.
+ */
+void inject_poll(int floor, int degraded);
+
+#endif
@@ -1,25 +1,98 @@
 #include "queue.h"
+#include "timer.h"
+#include "traffic.h"
 
-static int order_up[HARDWARE_NUMBER_OF_FLOORS];
+#include <stddef.h>
 
-static int order_down[HARDWARE_NUMBER_OF_FLOORS];
+/**
+ * @brief index of the up and down call in a floor's records.
+ */
+enum { CALL_UP, CALL_DOWN };
+
+/**
+ * @brief all calls, 8 bytes each, so the whole queue fits in one cache line.
+ */
+static QueueCall calls[HARDWARE_NUMBER_OF_FLOORS][2];
+
+_Static_assert(HARDWARE_NUMBER_OF_FLOORS <= 8, "destinations must fit in a byte");
+
+/**
+ * @brief the oldest outstanding call, or NULL if the queue is empty.
+ */
+static QueueCall *oldest;
+
+static int oldest_floor;
+
+static void queue_find_oldest(){
+    unsigned int now = timer_now_ms();
+    oldest = NULL;
+    for (int f = 0; f < HARDWARE_NUMBER_OF_FLOORS; f++){
+        for (int d = CALL_UP; d <= CALL_DOWN; d++){
+            QueueCall *call = &calls[f][d];
+            if ((call->origin & ~QUEUE_ORIGIN_PARK) && (!oldest || now - call->placed_ms > now - oldest->placed_ms)){
+                oldest = call;
+                oldest_floor = f;
+            }
+        }
+    }
+}
+
+/**
+ * @return true(1) if there was no passenger call in @p direction at @p floor
+ * before, and this is one.
+ */
+static int queue_place(int floor, int direction, QueueOrigin origin){
+    QueueCall *call = &calls[floor][direction];
+    int placed = !(call->origin & ~QUEUE_ORIGIN_PARK) && origin != QUEUE_ORIGIN_PARK;
+    if (placed){
+        call->placed_ms = timer_now_ms();
+        if (!oldest){
+            oldest = call;
+            oldest_floor = floor;
+        }
+    }
+    call->origin |= origin;
+    return placed;
+}
 
 void queue_set_order(int floor, HardwareOrder order){
     if (order == HARDWARE_ORDER_INSIDE){
-        order_up[floor] = 1;
-        order_down[floor] = 1;
+        queue_place(floor, CALL_UP, QUEUE_ORIGIN_CAR);
+        queue_place(floor, CALL_DOWN, QUEUE_ORIGIN_CAR);
     }
-    if (order == HARDWARE_ORDER_UP){
-        order_up[floor] = 1;
+    if (order == HARDWARE_ORDER_UP && queue_place(floor, CALL_UP, QUEUE_ORIGIN_HALL)){
+        traffic_record_call(floor, order);
     }
-    if (order == HARDWARE_ORDER_DOWN){
-        order_down[floor] = 1;
+    if (order == HARDWARE_ORDER_DOWN && queue_place(floor, CALL_DOWN, QUEUE_ORIGIN_HALL)){
+        traffic_record_call(floor, order);
     }
 }
 
+void queue_set_destination(int floor, int destination){
+    int direction = destination > floor ? CALL_UP : CALL_DOWN;
+    if (queue_place(floor, direction, QUEUE_ORIGIN_HALL)){
+        traffic_record_call(floor, direction == CALL_UP ? HARDWARE_ORDER_UP : HARDWARE_ORDER_DOWN);
+    }
+    calls[floor][direction].destinations |= 1 << destination;
+}
+
+void queue_set_park(int floor){
+    queue_place(floor, CALL_UP, QUEUE_ORIGIN_PARK);
+    queue_place(floor, CALL_DOWN, QUEUE_ORIGIN_PARK);
+}
+
+int queue_empty(){
+    for (int f = 0; f < HARDWARE_NUMBER_OF_FLOORS; f++){
+        if (calls[f][CALL_UP].origin || calls[f][CALL_DOWN].origin){
+            return 0;
+        }
+    }
+    return 1;
+}
+
 int queue_order_above(int floor){
     for (int f = floor; f < HARDWARE_NUMBER_OF_FLOORS; f++){
-        if (order_up[f] || order_down[f]){
+        if (calls[f][CALL_UP].origin || calls[f][CALL_DOWN].origin){
             return 1;
         }
     }
@@ -28,7 +101,7 @@ int queue_order_above(int floor){
 
 int queue_order_below(int floor){
     for (int f = floor; f>= 0; f--){
-        if (order_up[f] || order_down[f]){
+        if (calls[f][CALL_UP].origin || calls[f][CALL_DOWN].origin){
             return 1;
         }
     }
@@ -37,22 +110,83 @@ int queue_order_below(int floor){
 
 int queue_order_at(int floor, HardwareMovement direction){
     if (direction == HARDWARE_MOVEMENT_UP){
-        return order_up[floor];
+        return calls[floor][CALL_UP].origin != 0;
     }
     if (direction == HARDWARE_MOVEMENT_DOWN){
-        return order_down[floor];
+        return calls[floor][CALL_DOWN].origin != 0;
     }
     return 0;
 }
 
-void queue_delete_element(int floor){
-    order_up[floor]=0;
-    order_down[floor]=0;
+int queue_hall_call_at(int floor, HardwareMovement direction){
+    if (direction == HARDWARE_MOVEMENT_UP){
+        return (calls[floor][CALL_UP].origin & QUEUE_ORIGIN_HALL) != 0;
+    }
+    if (direction == HARDWARE_MOVEMENT_DOWN){
+        return (calls[floor][CALL_DOWN].origin & QUEUE_ORIGIN_HALL) != 0;
+    }
+    return 0;
+}
+
+int queue_car_call_at(int floor){
+    return ((calls[floor][CALL_UP].origin | calls[floor][CALL_DOWN].origin) & QUEUE_ORIGIN_CAR) != 0;
+}
+
+int queue_oldest(int *floor){
+    if (!oldest){
+        return -1;
+    }
+    if (floor){
+        *floor = oldest_floor;
+    }
+    return (int)(timer_now_ms() - oldest->placed_ms);
+}
+
+int queue_overdue_floor(){
+    int floor;
+    int age = queue_oldest(&floor);
+    if (age < 0 || age < QUEUE_MAX_WAIT_MS){
+        return -1;
+    }
+    return floor;
+}
+
+int queue_destination_call_at(int floor, HardwareMovement direction){
+    if (direction == HARDWARE_MOVEMENT_UP){
+        return calls[floor][CALL_UP].destinations != 0;
+    }
+    if (direction == HARDWARE_MOVEMENT_DOWN){
+        return calls[floor][CALL_DOWN].destinations != 0;
+    }
+    return 0;
+}
+
+void queue_delete_element(int floor, HardwareMovement direction){
+    QueueCall *served = &calls[floor][direction == HARDWARE_MOVEMENT_UP ? CALL_UP : CALL_DOWN];
+    QueueCall *waiting = &calls[floor][direction == HARDWARE_MOVEMENT_UP ? CALL_DOWN : CALL_UP];
+    int had_oldest = oldest == served || oldest == waiting;
+    unsigned char boarding = served->destinations;
+    *served = (QueueCall){0};
+    if (waiting->destinations){
+        waiting->origin = QUEUE_ORIGIN_HALL;
+    }
+    else{
+        *waiting = (QueueCall){0};
+    }
+    if (had_oldest){
+        queue_find_oldest();
+    }
+    for (int f = 0; f < HARDWARE_NUMBER_OF_FLOORS; f++){
+        if (boarding & (1 << f)){
+            queue_set_order(f, HARDWARE_ORDER_INSIDE);
+        }
+    }
 }
 
 void queue_delete_all(){
     for (int i = 0; i < HARDWARE_NUMBER_OF_FLOORS; i++){
-        order_up[i]= 0;
-        order_down[i]=0;
+        calls[i][CALL_UP] = (QueueCall){0};
+        calls[i][CALL_DOWN] = (QueueCall){0};
     }
+    oldest = NULL;
 }
@@ -6,13 +6,65 @@
 #include "hardware.h"
 
 /**
- * @brief Add orders to queue
- * @param floor which floor there are added a command in. Tells what element in
- * array that should be high(1).
- * @param order which direction. Tells what array to put the order in.
+ * @brief upper bound in milliseconds on how long a call may wait before
+ * the elevator goes straight for it.
+ */
+#ifndef QUEUE_MAX_WAIT_MS
+#define QUEUE_MAX_WAIT_MS 60000
+#endif
+
+/**
+ * @brief where a call was placed. Used as bit flags, since a floor can
+ * have both a hall call and a car call. A parking target is placed by the
+ * elevator itself: it has no light and does not age like a passenger call.
+ */
+typedef enum {
+    QUEUE_ORIGIN_HALL = 1,
+    QUEUE_ORIGIN_CAR = 2,
+    QUEUE_ORIGIN_PARK = 4
+} QueueOrigin;
+
+/**
+ * @brief record of a call in one direction at one floor.
+ */
+typedef struct {
+    unsigned int placed_ms;     /**< @c timer_now_ms when the call was placed */
+    unsigned char origin;       /**< QueueOrigin bits, 0 if there is no call */
+    unsigned char destinations; /**< destination dispatch: bit f set if someone waiting here is going to floor f */
+} QueueCall;
+
+/**
+ * @brief Add orders to queue. The placement time of a call is kept until it is deleted.
+ * @param floor which floor there are added a command in.
+ * @param order which direction. Tells what record to put the order in, and
+ * whether it is a hall call or a car call.
  */
 void queue_set_order(int floor, HardwareOrder order);
 
+/**
+ * @brief Add a destination call, entered on a hall panel at @p floor.
+ * Places a hall call towards @p destination. All passengers going to the
+ * same floor share one car call, which is registered when the elevator
+ * stops at @p floor to pick them up.
+ * @param floor where the passenger is waiting.
+ * @param destination where the passenger is going. Must differ from @p floor.
+ */
+void queue_set_destination(int floor, int destination);
+
+/**
+ * @brief Add a parking target at @p floor. The elevator stops there like for
+ * a car call, but no button is lit and the target is left out of
+ * @c queue_oldest.
+ * @param floor where to park.
+ */
+void queue_set_park(int floor);
+
+/**
+ * @brief checks if there are no calls and no parking target.
+ * @return true(1) or false(0).
+ */
+int queue_empty();
+
 /** 
  * @brief checks if there is any order above.
  * @param floor Which floor we are in.
@@ -36,12 +88,53 @@ int queue_order_below(int floor);
 int queue_order_at(int floor, HardwareMovement direction);
 
 /**
- * @brief deletes element from both arrays.
+ * @brief checks if there is a hall call at @p floor in @p direction
+ * @param floor Which floor to check.
+ * @param direction Which direction to check.
+ * @return true(1) or false(0).
+ */
+int queue_hall_call_at(int floor, HardwareMovement direction);
+
+/**
+ * @brief checks if there is a car call at @p floor
+ * @param floor Which floor to check.
+ * @return true(1) or false(0).
+ */
+int queue_car_call_at(int floor);
+
+/**
+ * @brief finds the oldest outstanding passenger call in constant time.
+ * @param floor Set to the floor of the oldest call, if there is one. May be NULL.
+ * @return how many milliseconds the oldest call has waited, -1 if there are no
+ * passenger calls.
+ */
+int queue_oldest(int *floor);
+
+/**
+ * @brief checks if the oldest call has waited longer than @c QUEUE_MAX_WAIT_MS.
+ * @return the floor of that call, or -1.
+ */
+int queue_overdue_floor();
+
+/**
+ * @brief checks if destination calls wait at @p floor to go in @p direction
+ * @param floor Which floor to check.
+ * @param direction Which direction to check.
+ * @return true(1) or false(0).
+ */
+int queue_destination_call_at(int floor, HardwareMovement direction);
+
+/**
+ * @brief deletes the calls at @p floor served by a car leaving in @p direction.
+ * Destination calls waiting to go that way are picked up and become car calls.
+ * Destination calls waiting to go the other way cannot board, and stay queued
+ * for a later stop; any other call at @p floor is deleted.
  * @param floor Which floor we are in.
+ * @param direction Which way the car leaves, HARDWARE_MOVEMENT_UP or HARDWARE_MOVEMENT_DOWN.
  */
-void queue_delete_element(int floor);
+void queue_delete_element(int floor, HardwareMovement direction);
 
 /**
- * @brief deletes all elements from array
+ * @brief deletes all calls
  */
 void queue_delete_all();
@@ -1,15 +1,25 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <time.h>
 #include <stdio.h>
 
-clock_t static start_time;
+static struct timespec start_time;
 
 void timer_start(){
-    start_time = clock();
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
 }
 
 int timer_less_than(int sec){
-    if(((clock()-start_time)/CLOCKS_PER_SEC) >= sec){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if((now.tv_sec - start_time.tv_sec) - (now.tv_nsec < start_time.tv_nsec) >= sec){
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
+
+unsigned int timer_now_ms(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned int)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
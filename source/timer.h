@@ -17,4 +17,11 @@ void timer_start();
  */
 int timer_less_than(int sec);
 
+/**
+ * @brief reads the monotonic clock.
+ * @return milliseconds since an arbitrary point. Wraps around, so only
+ * differences between two readings are meaningful.
+ */
+unsigned int timer_now_ms();
+
 #endif
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "traffic.h"
+#include "timer.h"
+
+#include <math.h>
+#include <stdio.h>
+
+/**
+ * @brief share of calls that makes a peak regime active, and the share it
+ * must drop below before the regime is left again.
+ */
+#define TRAFFIC_PEAK_ENTER 0.6
+#define TRAFFIC_PEAK_EXIT 0.4
+
+/**
+ * @brief calls per window below which the traffic counts as idle, and the
+ * number it must rise above before idle is left again.
+ */
+#define TRAFFIC_IDLE_ENTER 2.0
+#define TRAFFIC_IDLE_EXIT 4.0
+
+/**
+ * @brief decaying call counts, roughly the calls in the last
+ * @c TRAFFIC_WINDOW_MS, split by direction and floor band.
+ * The lobby band is the ground floor, the upper band all others.
+ */
+static double up_lobby;
+static double up_upper;
+static double down_upper;
+
+static unsigned int last_update_ms;
+
+static TrafficRegime regime = TRAFFIC_IDLE;
+
+static unsigned int regime_since_ms;
+
+static void traffic_decay(){
+    unsigned int now = timer_now_ms();
+    double k = exp(-(double)(now - last_update_ms) / TRAFFIC_WINDOW_MS);
+    up_lobby *= k;
+    up_upper *= k;
+    down_upper *= k;
+    last_update_ms = now;
+}
+
+void traffic_reset(){
+    up_lobby = 0;
+    up_upper = 0;
+    down_upper = 0;
+    last_update_ms = timer_now_ms();
+    regime = TRAFFIC_IDLE;
+    regime_since_ms = last_update_ms;
+}
+
+void traffic_record_call(int floor, HardwareOrder order){
+    traffic_decay();
+    if (order == HARDWARE_ORDER_UP){
+        if (floor == 0){
+            up_lobby += 1;
+        }
+        else{
+            up_upper += 1;
+        }
+    }
+    if (order == HARDWARE_ORDER_DOWN){
+        down_upper += 1;
+    }
+}
+
+static TrafficRegime traffic_candidate(double total, double up_share, double down_share){
+    switch (regime){
+    case TRAFFIC_IDLE:
+        if (total <= TRAFFIC_IDLE_EXIT){
+            return TRAFFIC_IDLE;
+        }
+        break;
+    case TRAFFIC_UP_PEAK:
+        if (total >= TRAFFIC_IDLE_ENTER && up_share >= TRAFFIC_PEAK_EXIT){
+            return TRAFFIC_UP_PEAK;
+        }
+        break;
+    case TRAFFIC_DOWN_PEAK:
+        if (total >= TRAFFIC_IDLE_ENTER && down_share >= TRAFFIC_PEAK_EXIT){
+            return TRAFFIC_DOWN_PEAK;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (total < TRAFFIC_IDLE_ENTER){
+        return TRAFFIC_IDLE;
+    }
+    if (up_share >= TRAFFIC_PEAK_ENTER){
+        return TRAFFIC_UP_PEAK;
+    }
+    if (down_share >= TRAFFIC_PEAK_ENTER){
+        return TRAFFIC_DOWN_PEAK;
+    }
+    return TRAFFIC_INTERFLOOR;
+}
+
+TrafficRegime traffic_classify(){
+    traffic_decay();
+    if (last_update_ms - regime_since_ms < TRAFFIC_MIN_DWELL_MS){
+        return regime;
+    }
+
+    double total = up_lobby + up_upper + down_upper;
+    double up_share = total > 0 ? up_lobby / total : 0;
+    double down_share = total > 0 ? down_upper / total : 0;
+
+    TrafficRegime next = traffic_candidate(total, up_share, down_share);
+    if (next != regime){
+        printf("traffic: %u %s -> %s calls=%.1f up_lobby=%.2f down_upper=%.2f\n",
+            last_update_ms, traffic_regime_name(regime), traffic_regime_name(next),
+            total, up_share, down_share);
+        fflush(stdout);
+        regime = next;
+        regime_since_ms = last_update_ms;
+    }
+    return regime;
+}
+
+TrafficPolicy traffic_policy(){
+    switch (regime){
+    case TRAFFIC_UP_PEAK:
+        return (TrafficPolicy){0, HARDWARE_MOVEMENT_DOWN};
+    case TRAFFIC_DOWN_PEAK:
+        return (TrafficPolicy){HARDWARE_NUMBER_OF_FLOORS - 1, HARDWARE_MOVEMENT_UP};
+    case TRAFFIC_INTERFLOOR:
+        return (TrafficPolicy){HARDWARE_NUMBER_OF_FLOORS / 2, HARDWARE_MOVEMENT_STOP};
+    default:
+        return (TrafficPolicy){-1, HARDWARE_MOVEMENT_STOP};
+    }
+}
+
+const char *traffic_regime_name(TrafficRegime which){
+    switch (which){
+    case TRAFFIC_UP_PEAK:
+        return "up_peak";
+    case TRAFFIC_DOWN_PEAK:
+        return "down_peak";
+    case TRAFFIC_INTERFLOOR:
+        return "interfloor";
+    default:
+        return "idle";
+    }
+}
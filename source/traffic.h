@@ -0,0 +1,72 @@
+#ifndef TRAFFIC_H
+#define TRAFFIC_H
+/**
+ * @file
+ * @brief Classifies the traffic pattern from the stream of hall calls and
+ * picks the dispatch and parking policy that suits it.
+ */
+
+#include "hardware.h"
+
+/**
+ * @brief time constant in milliseconds of the call rate averages.
+ */
+#ifndef TRAFFIC_WINDOW_MS
+#define TRAFFIC_WINDOW_MS 300000
+#endif
+
+/**
+ * @brief least time in milliseconds between two switches of regime.
+ */
+#ifndef TRAFFIC_MIN_DWELL_MS
+#define TRAFFIC_MIN_DWELL_MS 120000
+#endif
+
+/**
+ * @brief traffic patterns told apart by the classifier.
+ */
+typedef enum {
+    TRAFFIC_IDLE,
+    TRAFFIC_UP_PEAK,
+    TRAFFIC_DOWN_PEAK,
+    TRAFFIC_INTERFLOOR
+} TrafficRegime;
+
+/**
+ * @brief what the elevator does differently in each regime.
+ */
+typedef struct {
+    int park_floor;                 /**< where to wait when idle, -1 to stay put */
+    HardwareMovement direction;     /**< direction to try first when leaving idle, @c HARDWARE_MOVEMENT_STOP to keep the last one */
+} TrafficPolicy;
+
+/**
+ * @brief forgets all recorded calls and returns to @c TRAFFIC_IDLE.
+ */
+void traffic_reset();
+
+/**
+ * @brief records a new hall call. Constant time.
+ * @param floor where the call was placed.
+ * @param order @c HARDWARE_ORDER_UP or @c HARDWARE_ORDER_DOWN.
+ */
+void traffic_record_call(int floor, HardwareOrder order);
+
+/**
+ * @brief reclassifies the traffic, switching regime with hysteresis.
+ * Every switch is written to stdout as a line starting with "traffic:".
+ * @return the active regime.
+ */
+TrafficRegime traffic_classify();
+
+/**
+ * @brief the policy of the active regime.
+ */
+TrafficPolicy traffic_policy();
+
+/**
+ * @brief name of @p which, as used in the exported switch lines.
+ */
+const char *traffic_regime_name(TrafficRegime which);
+
+#endif
@@ -0,0 +1,112 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "watchdog.h"
+#include "hardware.h"
+
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief bumped by every tick, watched by the timer signal.
+ */
+static volatile sig_atomic_t heartbeat;
+
+static volatile sig_atomic_t tripped;
+
+static volatile sig_atomic_t trips;
+
+static struct timespec last_kick;
+
+static int kicked;
+
+static int degraded;
+
+static int good_ticks;
+
+static unsigned long overruns;
+
+static long worst_us;
+
+static void watchdog_handler(int sig){
+    (void)(sig);
+    static sig_atomic_t last_heartbeat;
+    static int missed;
+
+    if (heartbeat != last_heartbeat){
+        last_heartbeat = heartbeat;
+        missed = 0;
+        return;
+    }
+    missed++;
+    if (missed == WATCHDOG_MISSED_DEADLINES){
+        hardware_emergency_stop();
+        tripped = 1;
+        trips++;
+    }
+}
+
+int watchdog_init(){
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = watchdog_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGALRM, &action, NULL) != 0){
+        return 1;
+    }
+
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_SIGNAL;
+    event.sigev_signo = SIGALRM;
+
+    timer_t timer;
+    if (timer_create(CLOCK_MONOTONIC, &event, &timer) != 0){
+        return 1;
+    }
+
+    struct itimerspec period;
+    period.it_interval.tv_sec = WATCHDOG_TICK_BUDGET_US / 1000000;
+    period.it_interval.tv_nsec = (WATCHDOG_TICK_BUDGET_US % 1000000) * 1000L;
+    period.it_value = period.it_interval;
+    return timer_settime(timer, 0, &period, NULL) != 0;
+}
+
+int watchdog_kick(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    heartbeat++;
+
+    if (kicked){
+        long tick_us = (now.tv_sec - last_kick.tv_sec) * 1000000L + (now.tv_nsec - last_kick.tv_nsec) / 1000;
+        if (tick_us > worst_us){
+            worst_us = tick_us;
+        }
+        if (tick_us > WATCHDOG_TICK_BUDGET_US){
+            overruns++;
+            degraded = 1;
+            good_ticks = 0;
+        }
+        else if (degraded && ++good_ticks >= WATCHDOG_RECOVERY_TICKS){
+            degraded = 0;
+        }
+    }
+    last_kick = now;
+    kicked = 1;
+    return degraded;
+}
+
+int watchdog_tripped(){
+    if (!tripped){
+        return 0;
+    }
+    tripped = 0;
+    return 1;
+}
+
+void watchdog_read_stats(WatchdogStats *stats){
+    stats->overruns = overruns;
+    stats->worst_us = worst_us;
+    stats->trips = trips;
+}
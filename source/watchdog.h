@@ -0,0 +1,70 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+/**
+ * @file
+ * @brief Deadline supervision of the control loop.
+ *
+ * Every tick has a time budget. A tick that goes over it is counted, and puts
+ * the controller in a degraded mode where non-critical work is shed until
+ * the loop keeps its deadlines again. Independently of the loop, a timer
+ * signal checks that ticks keep coming, and stops the motor if several
+ * deadlines in a row pass without one.
+ */
+
+/**
+ * @brief time budget of one tick in microseconds.
+ */
+#ifndef WATCHDOG_TICK_BUDGET_US
+#define WATCHDOG_TICK_BUDGET_US 20000
+#endif
+
+/**
+ * @brief deadlines the loop may miss in a row before the motor is stopped.
+ */
+#ifndef WATCHDOG_MISSED_DEADLINES
+#define WATCHDOG_MISSED_DEADLINES 5
+#endif
+
+/**
+ * @brief ticks in a row that must keep the budget before degraded mode is left.
+ */
+#ifndef WATCHDOG_RECOVERY_TICKS
+#define WATCHDOG_RECOVERY_TICKS 1000
+#endif
+
+/**
+ * @brief counters for reporting.
+ */
+typedef struct {
+    unsigned long overruns;     /**< ticks that went over budget */
+    long worst_us;              /**< longest tick seen */
+    unsigned long trips;        /**< times the watchdog stopped the motor */
+} WatchdogStats;
+
+/**
+ * @brief starts the watchdog timer.
+ * @return 0 on success. Non-zero for failure.
+ */
+int watchdog_init();
+
+/**
+ * @brief marks the start of a tick, and checks the previous one against the budget.
+ * @return 1 (true) while in degraded mode, 0 (false) else
+ */
+int watchdog_kick();
+
+/**
+ * @brief checks if the watchdog has stopped the motor since the last call.
+ * The stop bypasses the driver's own state, so the caller should command
+ * @c HARDWARE_MOVEMENT_STOP as well when this returns true.
+ * @return 1 (true) if it has, 0 (false) else
+ */
+int watchdog_tripped();
+
+/**
+ * @brief reads the counters.
+ * @param stats Counters to fill in.
+ */
+void watchdog_read_stats(WatchdogStats *stats);
+
+#endif